@@ -1080,7 +1080,7 @@ namespace basecode::compiler {
                             return false;
 
                         auto signature_id = common::id_pool::instance()->allocate();
-                        func->call_site_arguments.insert(std::make_pair(signature_id, args));
+                        ffi.register_call_site(func, signature_id, args);
 
                         block->call_foreign(
                             address_operand,
@@ -2412,6 +2412,57 @@ namespace basecode::compiler {
         return true;
     }
 
+    void byte_code_emitter::emit_zero_fill(
+            vm::instruction_block* block,
+            const vm::instruction_operand_t& base_local,
+            compiler::identifier* var) {
+        auto var_type = var->type_ref()->type();
+        auto size = var_type->size_in_bytes();
+
+        size_t width = 8;
+        while (size % width != 0)
+            width /= 2;
+        auto fill_size = vm::op_size_for_byte_size(width);
+
+        block->comment(
+            fmt::format("zero fill: {}: {}", var->label_name(), var_type->name()),
+            vm::comment_location_t::after_instruction);
+        block->fill(
+            fill_size,
+            base_local,
+            vm::instruction_operand_t(static_cast<uint64_t>(0), fill_size),
+            vm::instruction_operand_t(static_cast<uint64_t>(size / width), vm::op_sizes::dword));
+    }
+
+    bool byte_code_emitter::is_zero_initializer(compiler::identifier* var) {
+        auto var_type = var->type_ref()->type();
+        auto init = var->initializer();
+        if (init == nullptr)
+            return var_type->element_type() != element_type_t::rune_type;
+
+        switch (var_type->element_type()) {
+            case element_type_t::bool_type: {
+                bool value = true;
+                return var->as_bool(value) && !value;
+            }
+            case element_type_t::rune_type: {
+                return false;
+            }
+            default: {
+                if (var_type->number_class() == number_class_t::floating_point) {
+                    double value = 1.0;
+                    if (!var->as_float(value))
+                        return false;
+                    vm::register_value_alias_t alias {};
+                    alias.qwf = value;
+                    return alias.qw == 0;
+                }
+                uint64_t value = 1;
+                return var->as_integer(value) && value == 0;
+            }
+        }
+    }
+
     bool byte_code_emitter::emit_finalizer(
             vm::instruction_block* block,
             compiler::identifier* var) {
@@ -2436,6 +2487,14 @@ namespace basecode::compiler {
 
         uint64_t offset = 0;
 
+        auto zero_filled = false;
+        auto root_type = var->type_ref()->type();
+        if (root_type->is_composite_type()
+        &&  root_type->size_in_bytes() >= minimum_fill_size) {
+            emit_zero_fill(block, base_local, var);
+            zero_filled = true;
+        }
+
         while (!list.empty()) {
             auto next_var = list.front();
             list.erase(std::begin(list));
@@ -2447,8 +2506,10 @@ namespace basecode::compiler {
                 case element_type_t::bool_type:
                 case element_type_t::numeric_type:
                 case element_type_t::pointer_type: {
-                    if (!emit_primitive_initializer(block, base_local, next_var, offset))
-                        return false;
+                    if (!zero_filled || !is_zero_initializer(next_var)) {
+                        if (!emit_primitive_initializer(block, base_local, next_var, offset))
+                            return false;
+                    }
                     offset += var_type->size_in_bytes();
                     break;
                 }
@@ -2457,8 +2518,10 @@ namespace basecode::compiler {
                     auto composite_type = dynamic_cast<compiler::composite_type*>(var_type);
                     switch (composite_type->type()) {
                         case composite_types_t::enum_type: {
-                            if (!emit_primitive_initializer(block, base_local, next_var, offset))
-                                return false;
+                            if (!zero_filled || !is_zero_initializer(next_var)) {
+                                if (!emit_primitive_initializer(block, base_local, next_var, offset))
+                                    return false;
+                            }
                             offset += var_type->size_in_bytes();
                             break;
                         }
@@ -2479,6 +2542,12 @@ namespace basecode::compiler {
                     }
                     break;
                 }
+                case element_type_t::array_type: {
+                    // array elements have no initializers of their own; the
+                    // zero fill covers them when the variable is large enough
+                    offset += var_type->size_in_bytes();
+                    break;
+                }
                 default: {
                     break;
                 }
@@ -47,6 +47,10 @@ namespace basecode::compiler {
 
     class byte_code_emitter {
     public:
+        // composite initializers of at least this many bytes start with a
+        // single zero fill, so only the fields that aren't zero need stores
+        static constexpr size_t minimum_fill_size = 16;
+
         explicit byte_code_emitter(compiler::session& session);
 
         bool emit();
@@ -120,6 +124,13 @@ namespace basecode::compiler {
             compiler::identifier* var,
             int64_t offset);
 
+        void emit_zero_fill(
+            vm::instruction_block* block,
+            const vm::instruction_operand_t& base_local,
+            compiler::identifier* var);
+
+        bool is_zero_initializer(compiler::identifier* var);
+
         bool emit_finalizers(const identifier_by_section_t& vars);
 
         bool emit_initializers(const identifier_by_section_t& vars);
@@ -94,11 +94,21 @@ namespace basecode::compiler {
         size_t stack_size = 0;
         size_t ffi_heap_size = 4096;
         bool output_ast_graphs = false;
+        bool vm_lazy_flags = false;
+        bool vm_big_endian = false;
+        bool vm_superinstructions = false;
+        bool vm_jit = false;
+        bool directive_bump_allocator = false;
         vm::allocator* allocator = nullptr;
+        vm::execution_engine_t vm_engine = vm::execution_engine_t::stepped;
         boost::filesystem::path compiler_path;
         session_meta_options_t meta_options {};
         session_module_paths_t module_paths {};
         boost::filesystem::path dom_graph_file;
+        boost::filesystem::path load_image_file;
+        boost::filesystem::path write_image_file;
+        boost::filesystem::path vm_profile_file;
+        boost::filesystem::path vm_trace_file;
         session_definition_map_t definitions {};
         session_compile_callback compile_callback;
     };
@@ -14,6 +14,8 @@
 #include <vm/terp.h>
 #include <vm/assembler.h>
 #include <parser/parser.h>
+#include <vm/profiler.h>
+#include <vm/program_image.h>
 #include <vm/default_allocator.h>
 #include <debugger/environment.h>
 #include "session.h"
@@ -31,7 +33,14 @@ namespace basecode::compiler {
     session::session(
             const session_options_t& options,
             const path_list_t& source_files) : _ffi(new vm::ffi(options.ffi_heap_size)),
-                                               _terp(new vm::terp(_ffi, options.allocator, options.heap_size, options.stack_size)),
+                                               _terp(new vm::terp(
+                                                   _ffi,
+                                                   options.directive_bump_allocator ?
+                                                       &_bump_allocator :
+                                                       options.allocator,
+                                                   options.heap_size,
+                                                   options.stack_size,
+                                                   options.vm_engine)),
                                                _source_files(source_files),
                                                _options(options),
                                                _elements(new element_map()),
@@ -42,6 +51,10 @@ namespace basecode::compiler {
                                                _interned_strings(new string_intern_map()),
                                                _emitter(new compiler::byte_code_emitter(*this)),
                                                _scope_manager(new compiler::scope_manager(*this)) {
+        _terp->big_endian(options.vm_big_endian);
+        _terp->lazy_flags(options.vm_lazy_flags);
+        _terp->superinstructions(options.vm_superinstructions);
+        _terp->jit(options.vm_jit);
     }
 
     session::~session() {
@@ -81,6 +94,9 @@ namespace basecode::compiler {
     }
 
     bool session::compile() {
+        if (!_options.load_image_file.empty())
+            return load_image();
+
         auto& listing = _assembler->listing();
 
         time_task(
@@ -192,33 +208,114 @@ namespace basecode::compiler {
                 success = time_task(
                     "compiler: execute directives",
                     [&]() { return execute_directives(); });
+                if (success && !_options.write_image_file.empty()) {
+                    success = time_task(
+                        "assembler: write program image",
+                        [&]() { return write_image(_options.write_image_file); });
+                }
                 if (success) {
-                    if (_options.debugger) {
+                    if (!execute_program())
+                        return false;
+                }
+            }
+        }
+
+        return !_result.is_failed();
+    }
+
+    bool session::load_image() {
+        vm::program_image image {};
+        auto success = time_task(
+            "assembler: load program image",
+            [&]() {
+                return image.read(_result, _options.load_image_file)
+                    && image.load(_result, *_terp, *_ffi, *_assembler);
+            });
+        if (!success)
+            return false;
+
+        _run = image.run();
+        _disassembled = true;
+
+        if (_options.verbose) {
+            time_task(
+                "assembler: listing file",
+                [&]() {
+                    disassemble(stdout);
+                    fmt::print("\n");
+                    return true;
+                });
+        }
+
+        if (!execute_program())
+            return false;
+
+        return !_result.is_failed();
+    }
+
+    bool session::write_image(const boost::filesystem::path& path) {
+        disassemble(nullptr);
+
+        vm::program_image image {};
+        image.run(_run);
+        for (const auto& kvp : *_interned_strings)
+            image.add_interned_string(kvp.second, kvp.first);
+
+        return image.capture(_result, *_terp, *_ffi, *_assembler)
+            && image.write(_result, path);
+    }
+
+    bool session::execute_program() {
+        if (_options.debugger) {
 #if DEBUGGER_ENABLED
-                        disassemble(nullptr);
-                        debugger::environment env(*this);
-                        if (!env.initialize(_result))
-                            return false;
-                        env.run(_result);
-                        env.shutdown(_result);
+            disassemble(nullptr);
+            debugger::environment env(*this);
+            if (!env.initialize(_result))
+                return false;
+            env.run(_result);
+            env.shutdown(_result);
 #else
-                        fmt::print("\nNOTE: Debugger not enabled.\n");
-                        fmt::print("      Ensure you have ncurses installed and rebuild the compiler.\n");
+            fmt::print("\nNOTE: Debugger not enabled.\n");
+            fmt::print("      Ensure you have ncurses installed and rebuild the compiler.\n");
 #endif
-                    } else {
-                        if (_run) {
-                            success = time_task(
-                                "compiler: execute byte-code",
-                                [&]() { return run(); });
-                            if (!success)
-                                return false;
-                        }
-                    }
+        } else {
+            if (_run) {
+                vm::profiler profiler {};
+                if (!_options.vm_profile_file.empty())
+                    _terp->profiler(&profiler);
+
+                auto success = time_task(
+                    "compiler: execute byte-code",
+                    [&]() { return run(); });
+                _terp->profiler(nullptr);
+                if (!success) {
+                    if (!_options.vm_trace_file.empty())
+                        _terp->write_trace(_result, _options.vm_trace_file);
+                    return false;
+                }
+
+                if (!_options.vm_profile_file.empty()) {
+                    disassemble(nullptr);
+                    if (!profiler.write(_result, _options.vm_profile_file, _assembler->listing()))
+                        return false;
+                }
+
+                if (_options.verbose && _terp->superinstructions()) {
+                    fmt::print(
+                        "\nthreaded engine: fused {} instructions into {} superinstructions\n",
+                        _terp->fused_count(),
+                        _terp->superinstruction_count());
+                }
+
+                if (_options.verbose && _terp->jit()) {
+                    fmt::print(
+                        "\nthreaded engine: compiled {} native blocks\n",
+                        _terp->native_block_count());
                 }
             }
         }
 
-        return !_result.is_failed();
+        return true;
     }
 
     bool session::time_task(
@@ -493,6 +590,8 @@ namespace basecode::compiler {
     }
 
     vm::allocator* session::allocator() {
+        if (_options.directive_bump_allocator)
+            return &_bump_allocator;
         return _options.allocator;
     }
 
@@ -690,7 +789,10 @@ namespace basecode::compiler {
     }
 
     void session::disassemble(FILE* file) {
-        _assembler->disassemble();
+        if (!_disassembled) {
+            _assembler->disassemble();
+            _disassembled = true;
+        }
         if (file != nullptr) {
             fmt::print(file, "\n");
             _assembler->listing().write(file);
@@ -17,6 +17,7 @@
 #include <vector>
 #include <fmt/format.h>
 #include <common/defer.h>
+#include <vm/bump_allocator.h>
 #include <boost/filesystem.hpp>
 #include "compiler_types.h"
 
@@ -131,6 +132,10 @@ namespace basecode::compiler {
 
         bool type_check();
 
+        bool load_image();
+
+        bool execute_program();
+
         bool execute_directives();
 
         void initialize_core_types();
@@ -153,10 +158,13 @@ namespace basecode::compiler {
 
         bool should_read_variable(compiler::element* element);
 
+        bool write_image(const boost::filesystem::path& path);
+
         void write_code_dom_graph(const boost::filesystem::path& path);
 
     private:
         bool _run = false;
+        bool _disassembled = false;
         ast_map_t _asts {};
         common::result _result;
         vm::ffi* _ffi = nullptr;
@@ -168,6 +176,7 @@ namespace basecode::compiler {
         session_task_list_t _tasks {};
         element_map* _elements = nullptr;
         element_builder* _builder = nullptr;
+        vm::bump_allocator _bump_allocator {};
         vm::assembler* _assembler = nullptr;
         compiler::program* _program = nullptr;
         ast_evaluator* _ast_evaluator = nullptr;
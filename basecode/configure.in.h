@@ -15,6 +15,7 @@
 #define VER_MINOR (@VER_MINOR@)
 
 #define DEBUGGER_ENABLED (@DEBUGGER_ENABLED@)
+#define JIT_ENABLED (@JIT_ENABLED@)
 #define COMPILER_LIBRARY_NAME ("@COMPILER_LIBRARY_NAME@")
 #define SHARED_LIBRARY_PREFIX ("@SHARED_LIBRARY_PREFIX@")
 #define SHARED_LIBRARY_SUFFIX ("@SHARED_LIBRARY_SUFFIX@")
\ No newline at end of file
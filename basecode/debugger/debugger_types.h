@@ -37,6 +37,7 @@ namespace basecode::debugger {
     class footer_window;
     class header_window;
     class errors_window;
+    class history_window;
     class command_window;
     class assembly_window;
     class registers_window;
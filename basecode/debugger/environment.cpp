@@ -24,6 +24,7 @@
 #include "memory_window.h"
 #include "errors_window.h"
 #include "command_window.h"
+#include "history_window.h"
 #include "assembly_window.h"
 #include "registers_window.h"
 
@@ -50,6 +51,7 @@ namespace basecode::debugger {
         delete _footer_window;
         delete _memory_window;
         delete _command_window;
+        delete _history_window;
         delete _assembly_window;
         delete _registers_window;
     }
@@ -67,6 +69,7 @@ namespace basecode::debugger {
         _output_window->draw(*this);
         _stack_window->draw(*this);
         _command_window->draw(*this);
+        _history_window->draw(*this);
         _errors_window->draw(*this);
         refresh();
     }
@@ -113,7 +116,8 @@ namespace basecode::debugger {
                     break;
                 }
                 case KEY_F(2): {
-                    terp.reset();
+                    if (_snapshot.empty() || !terp.restore(r, _snapshot))
+                        terp.reset();
                     pc = terp.register_file().r[vm::register_pc].qw;
 
                     unwind_state_stack();
@@ -121,6 +125,7 @@ namespace basecode::debugger {
                     _output_window->clear();
                     _stack_window->mark_dirty();
                     _header_window->mark_dirty();
+                    _history_window->mark_dirty();
                     _memory_window->mark_dirty();
                     _registers_window->mark_dirty();
                     _assembly_window->move_to_address(pc);
@@ -129,6 +134,26 @@ namespace basecode::debugger {
                 case KEY_F(3): {
                     goto _exit;
                 }
+                case KEY_F(4): {
+                    _history_window->visible(!_history_window->visible());
+                    if (_history_window->visible()) {
+                        _history_window->mark_dirty();
+                        break;
+                    }
+
+                    // the windows under the history overlay are copied back
+                    // to the screen in full, not just their changed cells
+                    for (auto win : std::initializer_list<window*> {
+                            _stack_window,
+                            _output_window,
+                            _memory_window,
+                            _assembly_window,
+                            _registers_window}) {
+                        touchwin(win->ptr());
+                        win->mark_dirty();
+                    }
+                    break;
+                }
                 case KEY_F(8): {
                     if (current_state() == debugger_state_t::break_s) {
                         pop_state();
@@ -240,6 +265,7 @@ namespace basecode::debugger {
                 _stack_window->mark_dirty();
                 _header_window->mark_dirty();
                 _memory_window->mark_dirty();
+                _history_window->mark_dirty();
                 _registers_window->mark_dirty();
             }
 
@@ -372,6 +398,15 @@ namespace basecode::debugger {
         _errors_window->visible(false);
         _errors_window->initialize();
 
+        _history_window = new history_window(
+            _main_window,
+            2,
+            2,
+            _main_window->max_width() - 4,
+            _main_window->max_height() - 16);
+        _history_window->visible(false);
+        _history_window->initialize();
+
         // XXX: since we only have the one listing source file for now
         //      automatically select it.
         auto& listing = _session.assembler().listing();
@@ -379,6 +414,10 @@ namespace basecode::debugger {
         if (!file_names.empty())
             _assembly_window->source_file(listing.source_file(file_names.front()));
 
+        // restart (F2) puts the heap back, not just the registers
+        if (!_session.terp().snapshot(r, _snapshot))
+            return false;
+
         refresh();
         draw_all();
 
@@ -13,6 +13,7 @@
 
 #include <iostream>
 #include <ncurses.h>
+#include <vm/heap_snapshot.h>
 #include "debugger_types.h"
 
 namespace basecode::debugger {
@@ -86,6 +87,8 @@ namespace basecode::debugger {
         header_window* _header_window = nullptr;
         footer_window* _footer_window = nullptr;
         memory_window* _memory_window = nullptr;
+        vm::heap_snapshot _snapshot {};
+        history_window* _history_window = nullptr;
         command_window* _command_window = nullptr;
         assembly_window* _assembly_window = nullptr;
         std::stack<debugger_state_t> _state_stack {};
@@ -28,7 +28,7 @@ namespace basecode::debugger {
     }
 
     void footer_window::on_draw(environment& env) {
-        auto footer = fmt::format(" F1=Command | F2=Reset | F3=Exit | F8=Step | F9=Run {} ", "");
+        auto footer = fmt::format(" F1=Command | F2=Reset | F3=Exit | F4=History | F8=Step | F9=Run {} ", "");
 
         size_t pad_length = 0;
         size_t page_width = static_cast<size_t>(max_width());
@@ -0,0 +1,83 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#include <vm/terp.h>
+#include <fmt/format.h>
+#include <vm/assembler.h>
+#include <compiler/session.h>
+#include "environment.h"
+#include "history_window.h"
+
+namespace basecode::debugger {
+
+    history_window::history_window(
+            window* parent,
+            int x,
+            int y,
+            int width,
+            int height) : window(parent,
+                                 x,
+                                 y,
+                                 width,
+                                 height,
+                                 "History") {
+    }
+
+    void history_window::on_draw(environment& env) {
+        const auto& trace = env.session().terp().trace();
+
+        for (int row = 1; row < max_height() - 1; row++)
+            mvwhline(ptr(), row, 1, ' ', max_width() - 2);
+
+        if (trace.size() == 0) {
+            print_centered_window("No branches taken.");
+            return;
+        }
+
+        std::unordered_map<uint64_t, std::string> targets {};
+        auto& listing = env.session().assembler().listing();
+        for (const auto& file_name : listing.file_names()) {
+            auto source_file = listing.source_file(file_name);
+            if (source_file == nullptr)
+                continue;
+            for (const auto& line : source_file->lines) {
+                if (line.type == vm::listing_source_line_type_t::instruction)
+                    targets.insert(std::make_pair(line.address, line.source));
+            }
+        }
+
+        auto text_width = static_cast<size_t>(max_width() - 2);
+        int row = 1;
+        for (size_t i = 0; i < trace.size() && row < max_height() - 1; i++) {
+            const auto& entry = trace[i];
+
+            std::string target {};
+            auto it = targets.find(entry.to);
+            if (it != targets.end())
+                target = it->second;
+
+            auto line = fmt::format(
+                "${:016X} -> ${:016X}  {}",
+                entry.from,
+                entry.to,
+                target);
+            if (line.length() > text_width)
+                line.resize(text_width);
+            mvwprintw(ptr(), row, 1, "%s", line.c_str());
+            ++row;
+        }
+    }
+
+    bool history_window::on_update(environment& env) {
+        return false;
+    }
+
+};
@@ -19,3 +19,4 @@
 #include <vm/default_allocator.h>
 #include <common/hex_formatter.h>
 #include <common/string_support.h>
+#include <vm/size_class_allocator.h>
@@ -9,6 +9,7 @@
 //
 // ----------------------------------------------------------------------------
 
+#include <array>
 #include <sstream>
 #include <fmt/format.h>
 #include <common/defer.h>
@@ -16,222 +17,289 @@
 
 namespace basecode::syntax {
 
-    std::multimap<common::rune_t, lexer::lexer_case_callable> lexer::s_cases = {
+    enum char_classes_t : uint8_t {
+        none       = 0b00000000,
+        alpha      = 0b00000001,
+        digit      = 0b00000010,
+        space      = 0b00000100,
+    };
+
+    // classes of the ascii characters; bytes of multi-byte utf-8 sequences
+    // have no class
+    static constexpr std::array<uint8_t, 256> make_char_classes() {
+        std::array<uint8_t, 256> classes {};
+        for (size_t ch = 'a'; ch <= 'z'; ch++)
+            classes[ch] |= char_classes_t::alpha;
+        for (size_t ch = 'A'; ch <= 'Z'; ch++)
+            classes[ch] |= char_classes_t::alpha;
+        for (size_t ch = '0'; ch <= '9'; ch++)
+            classes[ch] |= char_classes_t::digit;
+        for (auto ch : {' ', '\t', '\n', '\v', '\f', '\r'})
+            classes[static_cast<uint8_t>(ch)] |= char_classes_t::space;
+        return classes;
+    }
+
+    static constexpr std::array<uint8_t, 256> s_char_classes = make_char_classes();
+
+    static inline bool is_alnum_char(uint8_t ch) {
+        return (s_char_classes[ch] & (char_classes_t::alpha | char_classes_t::digit)) != 0;
+    }
+
+    static inline bool is_space_char(uint8_t ch) {
+        return (s_char_classes[ch] & char_classes_t::space) != 0;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    // what has to follow a keyword for it to be one.  a keyword followed by
+    // anything else is lexed as an identifier.
+    enum class keyword_follow_t : uint8_t {
+        not_alnum,
+        not_identifier,
+        space,
+    };
+
+    struct keyword_t {
+        const char* text = nullptr;
+        size_t length = 0;
+        keyword_follow_t follow = keyword_follow_t::not_alnum;
+        const token_t* token = nullptr;
+    };
+
+    using keyword_table_t = std::array<keyword_t, 64>;
+
+    // the constants were picked so none of the keywords collide; a new
+    // keyword may need new ones.
+    static inline size_t keyword_hash(
+            uint8_t first,
+            uint8_t last,
+            size_t length) {
+        return (first * 5 + last * 30 + length * 2) & 63;
+    }
+
+    static keyword_table_t make_keyword_table(std::initializer_list<keyword_t> keywords) {
+        keyword_table_t table {};
+        for (auto keyword : keywords) {
+            keyword.length = strlen(keyword.text);
+            auto hash = keyword_hash(
+                static_cast<uint8_t>(keyword.text[0]),
+                static_cast<uint8_t>(keyword.text[keyword.length - 1]),
+                keyword.length);
+            table[hash] = keyword;
+        }
+        return table;
+    }
+
+    static keyword_table_t s_keywords = make_keyword_table({
+        {"break",       0, keyword_follow_t::not_alnum,      &s_break_literal},
+        {"case",        0, keyword_follow_t::space,          &s_case_literal},
+        {"continue",    0, keyword_follow_t::not_alnum,      &s_continue_literal},
+        {"defer",       0, keyword_follow_t::not_alnum,      &s_defer_literal},
+        {"else",        0, keyword_follow_t::not_alnum,      &s_else_literal},
+        {"enum",        0, keyword_follow_t::not_alnum,      &s_enum_literal},
+        {"fallthrough", 0, keyword_follow_t::not_alnum,      &s_fallthrough_literal},
+        {"false",       0, keyword_follow_t::not_alnum,      &s_false_literal},
+        {"for",         0, keyword_follow_t::space,          &s_for_literal},
+        {"from",        0, keyword_follow_t::not_alnum,      &s_from_literal},
+        {"if",          0, keyword_follow_t::not_alnum,      &s_if_literal},
+        {"import",      0, keyword_follow_t::not_alnum,      &s_import_literal},
+        {"in",          0, keyword_follow_t::not_identifier, &s_in_literal},
+        {"module",      0, keyword_follow_t::not_alnum,      &s_module_literal},
+        {"nil",         0, keyword_follow_t::not_alnum,      &s_nil_literal},
+        {"ns",          0, keyword_follow_t::not_alnum,      &s_namespace_literal},
+        {"proc",        0, keyword_follow_t::not_alnum,      &s_proc_literal},
+        {"return",      0, keyword_follow_t::not_alnum,      &s_return_literal},
+        {"rol",         0, keyword_follow_t::not_alnum,      &s_rol_literal},
+        {"ror",         0, keyword_follow_t::not_alnum,      &s_ror_literal},
+        {"shl",         0, keyword_follow_t::not_alnum,      &s_shl_literal},
+        {"shr",         0, keyword_follow_t::not_alnum,      &s_shr_literal},
+        {"struct",      0, keyword_follow_t::not_alnum,      &s_struct_literal},
+        {"switch",      0, keyword_follow_t::space,          &s_switch_literal},
+        {"true",        0, keyword_follow_t::not_alnum,      &s_true_literal},
+        {"union",       0, keyword_follow_t::not_alnum,      &s_union_literal},
+        {"while",       0, keyword_follow_t::not_alnum,      &s_while_literal},
+        {"with",        0, keyword_follow_t::not_alnum,      &s_with_literal},
+        {"xor",         0, keyword_follow_t::not_alnum,      &s_xor_literal},
+    });
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    lexer::lexer_case_table_t lexer::make_case_table(
+            std::initializer_list<std::pair<char, lexer_case_callable>> cases) {
+        lexer_case_table_t table {};
+        for (const auto& entry : cases)
+            table[static_cast<uint8_t>(entry.first)].push_back(entry.second);
+        return table;
+    }
+
+    lexer::lexer_case_table_t lexer::s_cases = make_case_table({
         // attribute
-        {'@', std::bind(&lexer::attribute, std::placeholders::_1, std::placeholders::_2)},
+        {'@', &lexer::attribute},
 
         // directive
-        {'#', std::bind(&lexer::directive, std::placeholders::_1, std::placeholders::_2)},
+        {'#', &lexer::directive},
 
         // +:=, add
-        {'+', std::bind(&lexer::plus_equal_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'+', std::bind(&lexer::plus, std::placeholders::_1, std::placeholders::_2)},
+        {'+', &lexer::plus_equal_operator},
+        {'+', &lexer::plus},
 
         // /:=, block comment, line comment, slash
-        {'/', std::bind(&lexer::divide_equal_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'/', std::bind(&lexer::block_comment, std::placeholders::_1, std::placeholders::_2)},
-        {'/', std::bind(&lexer::line_comment, std::placeholders::_1, std::placeholders::_2)},
-        {'/', std::bind(&lexer::slash, std::placeholders::_1, std::placeholders::_2)},
+        {'/', &lexer::divide_equal_operator},
+        {'/', &lexer::block_comment},
+        {'/', &lexer::line_comment},
+        {'/', &lexer::slash},
 
         // comma
-        {',', std::bind(&lexer::comma, std::placeholders::_1, std::placeholders::_2)},
+        {',', &lexer::comma},
 
         // caret
-        {'^', std::bind(&lexer::caret, std::placeholders::_1, std::placeholders::_2)},
+        {'^', &lexer::caret},
 
         // not equals, bang
-        //{0x2260, std::bind(&lexer::not_equals_operator, std::placeholders::_1, std::placeholders::_2)}, // ≠
-        {'!',    std::bind(&lexer::not_equals_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'!',    std::bind(&lexer::bang, std::placeholders::_1, std::placeholders::_2)},
+        //{0x2260, &lexer::not_equals_operator}, // ≠
+        {'!',    &lexer::not_equals_operator},
+        {'!',    &lexer::bang},
 
         // question
-        {'?', std::bind(&lexer::question, std::placeholders::_1, std::placeholders::_2)},
+        {'?', &lexer::question},
 
         // period/spread
-        {'.', std::bind(&lexer::period, std::placeholders::_1, std::placeholders::_2)},
-        {'.', std::bind(&lexer::spread, std::placeholders::_1, std::placeholders::_2)},
+        {'.', &lexer::period},
+        {'.', &lexer::spread},
 
         // ~:=, tilde
-        {'~', std::bind(&lexer::binary_not_equal_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'~', std::bind(&lexer::tilde, std::placeholders::_1, std::placeholders::_2)},
+        {'~', &lexer::binary_not_equal_operator},
+        {'~', &lexer::tilde},
 
         // assignment, scope operator, colon
-        {':', std::bind(&lexer::constant_assignment, std::placeholders::_1, std::placeholders::_2)},
-        {':', std::bind(&lexer::scope_operator, std::placeholders::_1, std::placeholders::_2)},
-        {':', std::bind(&lexer::assignment, std::placeholders::_1, std::placeholders::_2)},
-        {':', std::bind(&lexer::colon, std::placeholders::_1, std::placeholders::_2)},
+        {':', &lexer::constant_assignment},
+        {':', &lexer::scope_operator},
+        {':', &lexer::assignment},
+        {':', &lexer::colon},
 
         // %:=, percent, number literal
-        {'%', std::bind(&lexer::modulus_equal_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'%', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'%', std::bind(&lexer::percent, std::placeholders::_1, std::placeholders::_2)},
+        {'%', &lexer::modulus_equal_operator},
+        {'%', &lexer::number_literal},
+        {'%', &lexer::percent},
 
         // *:=, exponent, asterisk
-        {'*', std::bind(&lexer::multiply_equal_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'*', std::bind(&lexer::exponent, std::placeholders::_1, std::placeholders::_2)},
-        {'*', std::bind(&lexer::asterisk, std::placeholders::_1, std::placeholders::_2)},
+        {'*', &lexer::multiply_equal_operator},
+        {'*', &lexer::exponent},
+        {'*', &lexer::asterisk},
 
         // =>, equals
-        {'=', std::bind(&lexer::control_flow_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'=', std::bind(&lexer::equals_operator, std::placeholders::_1, std::placeholders::_2)},
+        {'=', &lexer::control_flow_operator},
+        {'=', &lexer::equals_operator},
 
         // less than equal, less than
-        {'<', std::bind(&lexer::less_than_equal_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'<', std::bind(&lexer::less_than_operator, std::placeholders::_1, std::placeholders::_2)},
+        {'<', &lexer::less_than_equal_operator},
+        {'<', &lexer::less_than_operator},
 
         // greater than equal, greater than
-        {'>', std::bind(&lexer::greater_than_equal_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'>', std::bind(&lexer::greater_than_operator, std::placeholders::_1, std::placeholders::_2)},
+        {'>', &lexer::greater_than_equal_operator},
+        {'>', &lexer::greater_than_operator},
 
         // &:=, logical and, bitwise and, ampersand
-        {'&', std::bind(&lexer::binary_and_equal_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'&', std::bind(&lexer::logical_and_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'&', std::bind(&lexer::ampersand_literal, std::placeholders::_1, std::placeholders::_2)},
+        {'&', &lexer::binary_and_equal_operator},
+        {'&', &lexer::logical_and_operator},
+        {'&', &lexer::ampersand_literal},
 
         // lambda literal, |:=, logical or, bitwise or, pipe
-        {'|', std::bind(&lexer::binary_or_equal_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'|', std::bind(&lexer::logical_or_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'|', std::bind(&lexer::lambda_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'|', std::bind(&lexer::pipe_literal, std::placeholders::_1, std::placeholders::_2)},
+        {'|', &lexer::binary_or_equal_operator},
+        {'|', &lexer::logical_or_operator},
+        {'|', &lexer::lambda_literal},
+        {'|', &lexer::pipe_literal},
 
         // raw block/braces
-        {'{', std::bind(&lexer::raw_block, std::placeholders::_1, std::placeholders::_2)},
-        {'{', std::bind(&lexer::left_curly_brace, std::placeholders::_1, std::placeholders::_2)},
-        {'}', std::bind(&lexer::right_curly_brace, std::placeholders::_1, std::placeholders::_2)},
+        {'{', &lexer::raw_block},
+        {'{', &lexer::left_curly_brace},
+        {'}', &lexer::right_curly_brace},
 
         // parens
-        {'(', std::bind(&lexer::left_paren, std::placeholders::_1, std::placeholders::_2)},
-        {')', std::bind(&lexer::right_paren, std::placeholders::_1, std::placeholders::_2)},
+        {'(', &lexer::left_paren},
+        {')', &lexer::right_paren},
 
         // square brackets
-        {'[', std::bind(&lexer::left_square_bracket, std::placeholders::_1, std::placeholders::_2)},
-        {']', std::bind(&lexer::right_square_bracket, std::placeholders::_1, std::placeholders::_2)},
+        {'[', &lexer::left_square_bracket},
+        {']', &lexer::right_square_bracket},
 
         // line terminator
-        {';', std::bind(&lexer::line_terminator, std::placeholders::_1, std::placeholders::_2)},
+        {';', &lexer::line_terminator},
 
         // label/character literal
-        {'\'', std::bind(&lexer::label, std::placeholders::_1, std::placeholders::_2)},
-        {'\'', std::bind(&lexer::character_literal, std::placeholders::_1, std::placeholders::_2)},
+        {'\'', &lexer::label},
+        {'\'', &lexer::character_literal},
 
         // string literal
-        {'"', std::bind(&lexer::string_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // return literal
-        {'r', std::bind(&lexer::return_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // true/fallthrough/false literals
-        {'t', std::bind(&lexer::true_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'f', std::bind(&lexer::fallthrough_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'f', std::bind(&lexer::false_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // nil/ns literals
-        {'n', std::bind(&lexer::nil_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'n', std::bind(&lexer::ns_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // module literals
-        {'m', std::bind(&lexer::module_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // import literal
-        // if literal
-        // in literal
-        {'i', std::bind(&lexer::import_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'i', std::bind(&lexer::if_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'i', std::bind(&lexer::in_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // enum literal
-        // else if/else literals
-        {'e', std::bind(&lexer::else_if_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'e', std::bind(&lexer::enum_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'e', std::bind(&lexer::else_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // from/for literal
-        {'f', std::bind(&lexer::from_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'f', std::bind(&lexer::for_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // break literal
-        {'b', std::bind(&lexer::break_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // defer literal
-        {'d', std::bind(&lexer::defer_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // continue/case literal
-        {'c', std::bind(&lexer::continue_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'c', std::bind(&lexer::case_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // proc literal
-        {'p', std::bind(&lexer::proc_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // union literal
-        {'u', std::bind(&lexer::union_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // rol/ror literal
-        {'r', std::bind(&lexer::rol_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'r', std::bind(&lexer::ror_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // switch/struct/shl/shr literal
-        {'s', std::bind(&lexer::switch_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'s', std::bind(&lexer::struct_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'s', std::bind(&lexer::shl_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'s', std::bind(&lexer::shr_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // while literal
-        {'w', std::bind(&lexer::while_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'w', std::bind(&lexer::with_literal, std::placeholders::_1, std::placeholders::_2)},
-
-        // xor literal
-        {'x', std::bind(&lexer::xor_literal, std::placeholders::_1, std::placeholders::_2)},
+        {'"', &lexer::string_literal},
+
+        // keywords, see s_keywords
+        {'b', &lexer::keyword},
+        {'c', &lexer::keyword},
+        {'d', &lexer::keyword},
+        {'e', &lexer::keyword},
+        {'f', &lexer::keyword},
+        {'i', &lexer::keyword},
+        {'m', &lexer::keyword},
+        {'n', &lexer::keyword},
+        {'p', &lexer::keyword},
+        {'r', &lexer::keyword},
+        {'s', &lexer::keyword},
+        {'t', &lexer::keyword},
+        {'u', &lexer::keyword},
+        {'w', &lexer::keyword},
+        {'x', &lexer::keyword},
 
         // identifier
-        {'_', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'a', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'b', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'c', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'d', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'e', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'f', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'g', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'h', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'i', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'j', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'k', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'l', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'m', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'n', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'o', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'p', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'q', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'r', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'s', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'t', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'u', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'v', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'w', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'x', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'y', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
-        {'z', std::bind(&lexer::identifier, std::placeholders::_1, std::placeholders::_2)},
+        {'_', &lexer::identifier},
+        {'a', &lexer::identifier},
+        {'b', &lexer::identifier},
+        {'c', &lexer::identifier},
+        {'d', &lexer::identifier},
+        {'e', &lexer::identifier},
+        {'f', &lexer::identifier},
+        {'g', &lexer::identifier},
+        {'h', &lexer::identifier},
+        {'i', &lexer::identifier},
+        {'j', &lexer::identifier},
+        {'k', &lexer::identifier},
+        {'l', &lexer::identifier},
+        {'m', &lexer::identifier},
+        {'n', &lexer::identifier},
+        {'o', &lexer::identifier},
+        {'p', &lexer::identifier},
+        {'q', &lexer::identifier},
+        {'r', &lexer::identifier},
+        {'s', &lexer::identifier},
+        {'t', &lexer::identifier},
+        {'u', &lexer::identifier},
+        {'v', &lexer::identifier},
+        {'w', &lexer::identifier},
+        {'x', &lexer::identifier},
+        {'y', &lexer::identifier},
+        {'z', &lexer::identifier},
 
         // number literal
-        {'-', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'_', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'$', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'%', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'@', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'0', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'1', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'2', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'3', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'4', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'5', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'6', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'7', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'8', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
-        {'9', std::bind(&lexer::number_literal, std::placeholders::_1, std::placeholders::_2)},
+        {'-', &lexer::number_literal},
+        {'_', &lexer::number_literal},
+        {'$', &lexer::number_literal},
+        {'%', &lexer::number_literal},
+        {'@', &lexer::number_literal},
+        {'0', &lexer::number_literal},
+        {'1', &lexer::number_literal},
+        {'2', &lexer::number_literal},
+        {'3', &lexer::number_literal},
+        {'4', &lexer::number_literal},
+        {'5', &lexer::number_literal},
+        {'6', &lexer::number_literal},
+        {'7', &lexer::number_literal},
+        {'8', &lexer::number_literal},
+        {'9', &lexer::number_literal},
 
         // -:=, minus, negate
-        {'-', std::bind(&lexer::minus_equal_operator, std::placeholders::_1, std::placeholders::_2)},
-        {'-', std::bind(&lexer::minus, std::placeholders::_1, std::placeholders::_2)},
-    };
+        {'-', &lexer::minus_equal_operator},
+        {'-', &lexer::minus},
+    });
 
     lexer::lexer(common::source_file* source_file) : _source_file(source_file) {
     }
@@ -291,20 +359,21 @@ namespace basecode::syntax {
         rewind_one_char();
         _source_file->push_mark();
 
-        auto case_range = s_cases.equal_range(rune);
-        for (auto it = case_range.first; it != case_range.second; ++it) {
-            token.radix = 10;
-            token.number_type = number_types_t::none;
+        if (rune >= 0 && static_cast<size_t>(rune) < s_cases.size()) {
             auto start_column = _source_file->column_by_index(_source_file->pos());
             auto start_line = _source_file->line_by_index(_source_file->pos());
-            if (it->second(this, token)) {
-                auto end_column = _source_file->column_by_index(_source_file->pos());
-                auto end_line = _source_file->line_by_index(_source_file->pos());
-                token.location.start(start_line->line, start_column);
-                token.location.end(end_line->line, end_column);
-                return true;
+            for (auto callable : s_cases[rune]) {
+                token.radix = 10;
+                token.number_type = number_types_t::none;
+                if ((this->*callable)(token)) {
+                    auto end_column = _source_file->column_by_index(_source_file->pos());
+                    auto end_line = _source_file->line_by_index(_source_file->pos());
+                    token.location.start(start_line->line, start_column);
+                    token.location.end(end_line->line, end_column);
+                    return true;
+                }
+                _source_file->restore_top_mark();
             }
-            _source_file->restore_top_mark();
         }
 
         token = s_invalid;
@@ -336,93 +405,80 @@ namespace basecode::syntax {
         if (ch != '_' && !isalpha(ch)) {
             return "";
         }
-        std::stringstream stream;
+        std::string value;
         // XXX: requires utf8 fix
-        stream << static_cast<char>(ch);
+        value += static_cast<char>(ch);
         while (true) {
             ch = read(false);
             if (ch == ';') {
-                return stream.str();
+                return value;
             }
             if (ch == '_' || isalnum(ch)) {
                 // XXX: requires utf8 fix
-                stream << static_cast<char>(ch);
+                value += static_cast<char>(ch);
                 continue;
             }
-            return stream.str();
+            return value;
         }
     }
 
-    bool lexer::enum_literal(token_t& token) {
-        if (match_literal("enum")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_enum_literal;
-                return true;
-            }
-        }
-        return false;
-    }
+    // keywords all start with a lower case letter, so this case only runs
+    // for those.  the run of ascii letters and digits at the current
+    // position is looked up in s_keywords.
+    bool lexer::keyword(token_t& token) {
+        auto start = _source_file->pos();
+        auto length = _source_file->length();
+        auto end = start;
+        while (end < length && is_alnum_char((*_source_file)[end]))
+            ++end;
 
-    bool lexer::break_literal(token_t& token) {
-        if (match_literal("break")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_break_literal;
-                return true;
-            }
-        }
-        return false;
-    }
+        auto run_length = end - start;
+        if (run_length < 2)
+            return false;
 
-    bool lexer::while_literal(token_t& token) {
-        if (match_literal("while")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_while_literal;
-                return true;
-            }
+        const auto& keyword = s_keywords[keyword_hash(
+            (*_source_file)[start],
+            (*_source_file)[end - 1],
+            run_length)];
+        if (keyword.length != run_length)
+            return false;
+        for (size_t i = 0; i < run_length; i++) {
+            if ((*_source_file)[start + i] != static_cast<uint8_t>(keyword.text[i]))
+                return false;
         }
-        return false;
-    }
 
-    bool lexer::struct_literal(token_t& token) {
-        if (match_literal("struct")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_struct_literal;
-                return true;
+        uint8_t follow = end < length ? (*_source_file)[end] : 0;
+        switch (keyword.follow) {
+            case keyword_follow_t::not_alnum: {
+                break;
             }
-        }
-        return false;
-    }
-
-    bool lexer::union_literal(token_t& token) {
-        if (match_literal("union")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_union_literal;
-                return true;
+            case keyword_follow_t::not_identifier: {
+                if (follow == '_')
+                    return false;
+                break;
+            }
+            case keyword_follow_t::space: {
+                if (!is_space_char(follow))
+                    return false;
+                break;
             }
         }
-        return false;
-    }
 
-    bool lexer::continue_literal(token_t& token) {
-        if (match_literal("continue")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_continue_literal;
-                return true;
-            }
+        // else if is a single token
+        if (keyword.token == &s_else_literal
+        &&  end + 3 <= length
+        &&  (*_source_file)[end] == ' '
+        &&  (*_source_file)[end + 1] == 'i'
+        &&  (*_source_file)[end + 2] == 'f'
+        &&  (end + 3 == length || !is_alnum_char((*_source_file)[end + 3]))) {
+            token = s_else_if_literal;
+            _source_file->seek(end + 3);
+            return true;
         }
-        return false;
+
+        token = *keyword.token;
+        _source_file->seek(end);
+        return true;
     }
 
     bool lexer::left_curly_brace(token_t& token) {
@@ -444,15 +500,15 @@ namespace basecode::syntax {
     }
 
     std::string lexer::read_until(char target_ch) {
-        std::stringstream stream;
+        std::string value;
         while (true) {
             auto ch = read(false);
             if (ch == target_ch || ch == -1)
                 break;
             // XXX: requires utf8 fix
-            stream << static_cast<char>(ch);
+            value += static_cast<char>(ch);
         }
-        return stream.str();
+        return value;
     }
 
     bool lexer::plus(token_t& token) {
@@ -700,18 +756,6 @@ namespace basecode::syntax {
         return false;
     }
 
-    bool lexer::in_literal(token_t& token) {
-        if (match_literal("in")) {
-            auto ch = read(false);
-            if (!isalnum(ch) && ch != '_') {
-                rewind_one_char();
-                token = s_in_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
     bool lexer::right_paren(token_t& token) {
         auto ch = read();
         if (ch == ')') {
@@ -723,126 +767,6 @@ namespace basecode::syntax {
         return false;
     }
 
-    bool lexer::case_literal(token_t& token) {
-        if (match_literal("case")) {
-            auto ch = read(false);
-            if (isspace(ch)) {
-                rewind_one_char();
-                token = s_case_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::proc_literal(token_t& token) {
-        if (match_literal("proc")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_proc_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::ns_literal(token_t& token) {
-        if (match_literal("ns")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_namespace_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::if_literal(token_t& token) {
-        if (match_literal("if")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_if_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::xor_literal(token_t& token) {
-        if (match_literal("xor")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_xor_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::shl_literal(token_t& token) {
-        if (match_literal("shl")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_shl_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::shr_literal(token_t& token) {
-        if (match_literal("shr")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_shr_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::rol_literal(token_t& token) {
-        if (match_literal("rol")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_rol_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::ror_literal(token_t& token) {
-        if (match_literal("ror")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_ror_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::else_literal(token_t& token) {
-        if (match_literal("else")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_else_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
     bool lexer::line_comment(token_t& token) {
         auto ch = read();
         if (ch == '/') {
@@ -857,54 +781,6 @@ namespace basecode::syntax {
         return false;
     }
 
-    bool lexer::for_literal(token_t& token) {
-        if (match_literal("for")) {
-            auto ch = read(false);
-            if (isspace(ch)) {
-                rewind_one_char();
-                token = s_for_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::nil_literal(token_t& token) {
-        if (match_literal("nil")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_nil_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::with_literal(token_t& token) {
-        if (match_literal("with")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_with_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::true_literal(token_t& token) {
-        if (match_literal("true")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_true_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
     bool lexer::pipe_literal(token_t& token) {
         auto ch = read();
         if (ch == '|') {
@@ -924,30 +800,6 @@ namespace basecode::syntax {
         return false;
     }
 
-    bool lexer::false_literal(token_t& token) {
-        if (match_literal("false")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_false_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::defer_literal(token_t& token) {
-        if (match_literal("defer")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_defer_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
     bool lexer::number_literal(token_t& token) {
         std::stringstream stream;
         token.type = token_types_t::number_literal;
@@ -1031,18 +883,6 @@ namespace basecode::syntax {
         return true;
     }
 
-    bool lexer::switch_literal(token_t& token) {
-        if (match_literal("switch")) {
-            auto ch = read(false);
-            if (isspace(ch)) {
-                rewind_one_char();
-                token = s_switch_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
     bool lexer::lambda_literal(token_t& token) {
         auto ch = read();
         if (ch != '|')
@@ -1086,18 +926,6 @@ namespace basecode::syntax {
         return false;
     }
 
-    bool lexer::import_literal(token_t& token) {
-        if (match_literal("import")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_import_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
     bool lexer::scope_operator(token_t& token) {
         if (match_literal("::")) {
             auto ch = read(false);
@@ -1111,18 +939,6 @@ namespace basecode::syntax {
         return false;
     }
 
-    bool lexer::return_literal(token_t& token) {
-        if (match_literal("return")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_return_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
     bool lexer::line_terminator(token_t& token) {
         auto ch = read();
         if (ch == ';') {
@@ -1144,18 +960,6 @@ namespace basecode::syntax {
         return false;
     }
 
-    bool lexer::else_if_literal(token_t& token) {
-        if (match_literal("else if")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_else_if_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
     bool lexer::naked_identifier(token_t& token) {
         auto name = read_identifier();
 
@@ -1279,18 +1083,6 @@ namespace basecode::syntax {
         return false;
     }
 
-    bool lexer::fallthrough_literal(token_t& token) {
-        if (match_literal("fallthrough")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_fallthrough_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
     bool lexer::logical_or_operator(token_t& token) {
         auto ch = read();
         if (ch == '|') {
@@ -1348,30 +1140,6 @@ namespace basecode::syntax {
         return false;
     }
 
-    bool lexer::from_literal(token_t& token) {
-        if (match_literal("from")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_from_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
-    bool lexer::module_literal(token_t& token) {
-        if (match_literal("module")) {
-            auto ch = read(false);
-            if (!isalnum(ch)) {
-                rewind_one_char();
-                token = s_module_literal;
-                return true;
-            }
-        }
-        return false;
-    }
-
     bool lexer::plus_equal_operator(token_t& token) {
         if (match_literal("+:=")) {
             token = s_plus_equal_literal;
@@ -13,9 +13,9 @@
 
 #include <set>
 #include <map>
+#include <array>
 #include <vector>
 #include <istream>
-#include <functional>
 #include <common/rune.h>
 #include <common/source_file.h>
 #include "token.h"
@@ -24,7 +24,9 @@ namespace basecode::syntax {
 
     class lexer {
     public:
-        using lexer_case_callable = std::function<bool (lexer*, token_t&)>;
+        using lexer_case_callable = bool (lexer::*)(token_t&);
+
+        using lexer_case_table_t = std::array<std::vector<lexer_case_callable>, 128>;
 
         explicit lexer(common::source_file* source_file);
 
@@ -53,6 +55,8 @@ namespace basecode::syntax {
 
         bool label(token_t& token);
 
+        bool keyword(token_t& token);
+
         bool period(token_t& token);
 
         bool spread(token_t& token);
@@ -71,94 +75,36 @@ namespace basecode::syntax {
 
         bool raw_block(token_t& token);
 
-        bool in_literal(token_t& token);
-
-        bool if_literal(token_t& token);
-
         bool left_paren(token_t& token);
 
         bool identifier(token_t& token);
 
         bool assignment(token_t& token);
 
-        bool ns_literal(token_t& token);
-
-        bool xor_literal(token_t& token);
-
-        bool shl_literal(token_t& token);
-
-        bool shr_literal(token_t& token);
-
-        bool rol_literal(token_t& token);
-
-        bool ror_literal(token_t& token);
-
-        bool for_literal(token_t& token);
-
         bool right_paren(token_t& token);
 
-        bool nil_literal(token_t& token);
-
-        bool case_literal(token_t& token);
-
-        bool proc_literal(token_t& token);
-
-        bool enum_literal(token_t& token);
-
-        bool else_literal(token_t& token);
-
         bool line_comment(token_t& token);
 
         bool pipe_literal(token_t& token);
 
-        bool true_literal(token_t& token);
-
-        bool with_literal(token_t& token);
-
-        bool from_literal(token_t& token);
-
         bool block_comment(token_t& token);
 
-        bool false_literal(token_t& token);
-
-        bool defer_literal(token_t& token);
-
-        bool break_literal(token_t& token);
-
-        bool while_literal(token_t& token);
-
-        bool union_literal(token_t& token);
-
-        bool module_literal(token_t& token);
-
-        bool struct_literal(token_t& token);
-
-        bool return_literal(token_t& token);
-
         bool number_literal(token_t& token);
 
         bool scope_operator(token_t& token);
 
         bool string_literal(token_t& token);
 
-        bool import_literal(token_t& token);
-
         bool lambda_literal(token_t& token);
 
-        bool switch_literal(token_t& token);
-
         bool line_terminator(token_t& token);
 
         bool equals_operator(token_t& token);
 
-        bool else_if_literal(token_t& token);
-
         bool naked_identifier(token_t& token);
 
         bool left_curly_brace(token_t& token);
 
-        bool continue_literal(token_t& token);
-
         bool right_curly_brace(token_t& token);
 
         bool ampersand_literal(token_t& token);
@@ -167,8 +113,6 @@ namespace basecode::syntax {
 
         bool less_than_operator(token_t& token);
 
-        bool fallthrough_literal(token_t& token);
-
         bool not_equals_operator(token_t& token);
 
         bool left_square_bracket(token_t& token);
@@ -227,7 +171,11 @@ namespace basecode::syntax {
         bool read_hex_digits(size_t length, std::string& value);
 
     private:
-        static std::multimap<common::rune_t, lexer_case_callable> s_cases;
+        static lexer_case_table_t make_case_table(
+            std::initializer_list<std::pair<char, lexer_case_callable>> cases);
+
+        // the cases tried, in order, for each leading ascii character
+        static lexer_case_table_t s_cases;
 
         bool _has_next = true;
         uint32_t _paren_depth = 0;
@@ -147,6 +147,13 @@ namespace basecode::vm {
                         auto inst_size = inst->encode(r, entry.address());
                         if (inst_size == 0)
                             return false;
+
+                        if (inst->op == op_codes::ffi && !inst->operands[0].is_reg()) {
+                            _relocations.push_back(relocation_t {
+                                .type = relocation_type_t::foreign_function,
+                                .address = entry.address(),
+                            });
+                        }
                         break;
                     }
                     case block_entry_type_t::data_definition: {
@@ -183,6 +190,15 @@ namespace basecode::vm {
         highest_address += 8;
         _terp->heap_free_space_begin(common::align(highest_address, 8));
 
+        for (auto block : _blocks) {
+            for (auto& entry : block->entries()) {
+                if (entry.type() != block_entry_type_t::instruction)
+                    continue;
+                if (!_terp->prime_instruction_cache(r, entry.address()))
+                    return false;
+            }
+        }
+
         return !r.is_failed();
     }
 
@@ -217,6 +233,10 @@ namespace basecode::vm {
         return _listing;
     }
 
+    const relocation_list_t& assembler::relocations() const {
+        return _relocations;
+    }
+
     segment_list_t assembler::segments() const {
         segment_list_t list {};
         for (const auto& it : _segments) {
@@ -254,6 +274,10 @@ namespace basecode::vm {
                                     auto label = find_label(operand.fixup_ref1->name);
                                     if (label != nullptr) {
                                         operand.value.u = label->address();
+                                        _relocations.push_back(relocation_t {
+                                            .address = entry.address(),
+                                            .operand = static_cast<uint8_t>(i),
+                                        });
                                     }
                                     break;
                                 }
@@ -268,6 +292,8 @@ namespace basecode::vm {
                         auto data_def = entry.data<data_definition_t>();
                         if (data_def->type == data_definition_type_t::uninitialized)
                             break;
+                        auto size_in_bytes = op_size_in_bytes(data_def->size);
+                        auto address = entry.address();
                         for (auto& value : data_def->values) {
                             auto variant = value;
                             if (variant.which() == 1) {
@@ -278,6 +304,10 @@ namespace basecode::vm {
                                             auto label = find_label(named_ref->name);
                                             if (label != nullptr) {
                                                 value = label->address();
+                                                _relocations.push_back(relocation_t {
+                                                    .address = address,
+                                                    .size = data_def->size,
+                                                });
                                             }
                                             break;
                                         }
@@ -287,6 +317,7 @@ namespace basecode::vm {
                                     }
                                 }
                             }
+                            address += size_in_bytes;
                         }
                         break;
                     }
@@ -45,6 +45,10 @@ namespace basecode::vm {
 
         bool initialize(common::result& r);
 
+        // every absolute address assemble and resolve_labels encoded into
+        // the program region
+        const relocation_list_t& relocations() const;
+
         bool allocate_reg(register_t& reg);
 
         void free_reg(const register_t& reg);
@@ -94,6 +98,7 @@ namespace basecode::vm {
         uint64_t _location_counter = 0;
         vm::assembly_listing _listing {};
         assembly_symbol_resolver_t _resolver;
+        relocation_list_t _relocations {};
         std::vector<instruction_block*> _blocks {};
         register_allocator_t _register_allocator {};
         std::unordered_map<std::string, vm::label*> _labels {};
@@ -224,6 +224,11 @@ namespace basecode::vm {
                             auto number = std::atoi(operand.substr(1).c_str());
                             encoding.type = operand_encoding_t::flags::reg;
                             encoding.value.r = static_cast<uint8_t>(number);
+                        } else if (is_vector_register(operand)) {
+                            auto number = std::atoi(operand.substr(1).c_str());
+                            encoding.type = operand_encoding_t::flags::reg
+                                            | operand_encoding_t::flags::vector;
+                            encoding.value.r = static_cast<uint8_t>(number);
                         } else if ((operand[0] == 'F' || operand[0] == 'f')
                                 && (operand[1] == 'P' || operand[1] == 'p')) {
                             encoding.size = op_sizes::qword;
@@ -730,4 +735,18 @@ namespace basecode::vm {
         }
     }
 
+    bool assembly_parser::is_vector_register(const std::string& value) const {
+        if (value.length() > 3)
+            return false;
+
+        if (value[0] != 'v' && value[0] != 'V')
+            return false;
+
+        if (value.length() == 2) {
+            return static_cast<bool>(isdigit(value[1]));
+        } else {
+            return isdigit(value[1]) && isdigit(value[2]);
+        }
+    }
+
 };
\ No newline at end of file
@@ -90,6 +90,8 @@ namespace basecode::vm {
 
         bool is_integer_register(const std::string& value) const;
 
+        bool is_vector_register(const std::string& value) const;
+
     private:
         wip_t _wip {};
         void* _data = nullptr;
@@ -0,0 +1,71 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#include <common/bytes.h>
+#include "bump_allocator.h"
+
+namespace basecode::vm {
+
+    void bump_allocator::reset() {
+        _top = _start;
+    }
+
+    void bump_allocator::save(allocator_state_t& state) const {
+        state = {_end, _top, _size, _start, _address};
+    }
+
+    void bump_allocator::restore(const allocator_state_t& state) {
+        _end = state[0];
+        _top = state[1];
+        _size = state[2];
+        _start = state[3];
+        _address = state[4];
+    }
+
+    void bump_allocator::initialize(
+            uint64_t address,
+            uint64_t size) {
+        _size = size;
+        _address = address;
+        _start = common::align(address, alignment);
+        _end = _start < address + size ? address + size : _start;
+        reset();
+    }
+
+    uint64_t bump_allocator::alloc(uint64_t size) {
+        if (size > _end - _top)
+            return 0;
+
+        auto capacity = common::align(size == 0 ? 1 : size, alignment);
+        if (_end - _top < header_size + capacity)
+            return 0;
+
+        *reinterpret_cast<uint64_t*>(_top) = capacity;
+
+        auto address = _top + header_size;
+        _top = address + capacity;
+        return address;
+    }
+
+    uint64_t bump_allocator::free(uint64_t address) {
+        return size(address);
+    }
+
+    uint64_t bump_allocator::size(uint64_t address) {
+        if (address < _start + header_size
+        ||  address >= _top
+        ||  (address - _start) % alignment != 0) {
+            return 0;
+        }
+        return *reinterpret_cast<uint64_t*>(address - header_size);
+    }
+
+};
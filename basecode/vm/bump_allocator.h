@@ -0,0 +1,55 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "vm_types.h"
+
+namespace basecode::vm {
+
+    // blocks are carved in address order from the free space and are never
+    // reused: free only reports the size of the block and reset releases
+    // everything at once.  the size of each block is kept in a header in
+    // front of it inside the vm heap.
+    class bump_allocator : public allocator {
+    public:
+        static constexpr uint64_t alignment = 16;
+        static constexpr uint64_t header_size = alignment;
+
+        bump_allocator() = default;
+
+        ~bump_allocator() override = default;
+
+        void reset() override;
+
+        void save(allocator_state_t& state) const override;
+
+        void restore(const allocator_state_t& state) override;
+
+        void initialize(
+            uint64_t address,
+            uint64_t size) override;
+
+        uint64_t alloc(uint64_t size) override;
+
+        uint64_t size(uint64_t address) override;
+
+        uint64_t free(uint64_t address) override;
+
+    private:
+        uint64_t _end = 0;
+        uint64_t _top = 0;
+        uint64_t _size = 0;
+        uint64_t _start = 0;
+        uint64_t _address = 0;
+    };
+
+};
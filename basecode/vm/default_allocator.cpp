@@ -28,6 +28,39 @@ namespace basecode::vm {
             _head_heap_block));
     }
 
+    // the block list is saved as address, size and flags triples in list
+    // order, after the heap's address and size
+    void default_allocator::save(allocator_state_t& state) const {
+        state = {_size, _address};
+        for (auto block = _head_heap_block; block != nullptr; block = block->next) {
+            state.push_back(block->address);
+            state.push_back(block->size);
+            state.push_back(block->flags);
+        }
+    }
+
+    void default_allocator::restore(const allocator_state_t& state) {
+        free_heap_block_list();
+
+        _size = state[0];
+        _address = state[1];
+
+        heap_block_t* prev = nullptr;
+        for (size_t i = 2; i + 2 < state.size(); i += 3) {
+            auto block = new heap_block_t;
+            block->address = state[i];
+            block->size = state[i + 1];
+            block->flags = static_cast<uint8_t>(state[i + 2]);
+            block->prev = prev;
+            if (prev == nullptr)
+                _head_heap_block = block;
+            else
+                prev->next = block;
+            _address_blocks.insert(std::make_pair(block->address, block));
+            prev = block;
+        }
+    }
+
     void default_allocator::initialize(
             uint64_t address,
             uint64_t size) {
@@ -54,6 +54,10 @@ namespace basecode::vm {
 
         void reset() override;
 
+        void save(allocator_state_t& state) const override;
+
+        void restore(const allocator_state_t& state) override;
+
         void initialize(
             uint64_t address,
             uint64_t size) override;
@@ -18,71 +18,197 @@
 
 namespace basecode::vm {
 
-    ffi::ffi(size_t heap_size) : _heap_size(heap_size) {
+    static void push_nothing(DCCallVM*, DCstruct*, uint64_t) {
     }
 
-    ffi::~ffi() {
-        dcFree(_vm);
-        _vm = nullptr;
+    static void push_bool(DCCallVM* vm, DCstruct*, uint64_t value) {
+        dcArgBool(vm, static_cast<DCbool>(value));
     }
 
-    void ffi::push(
-            const function_value_t& param,
-            uint64_t value) {
+    static void push_char(DCCallVM* vm, DCstruct*, uint64_t value) {
+        dcArgChar(vm, static_cast<DCchar>(value));
+    }
+
+    static void push_short(DCCallVM* vm, DCstruct*, uint64_t value) {
+        dcArgShort(vm, static_cast<DCshort>(value));
+    }
+
+    static void push_int(DCCallVM* vm, DCstruct*, uint64_t value) {
+        dcArgInt(vm, static_cast<DCint>(value));
+    }
+
+    static void push_long(DCCallVM* vm, DCstruct*, uint64_t value) {
+        dcArgLong(vm, static_cast<DClong>(value));
+    }
+
+    static void push_long_long(DCCallVM* vm, DCstruct*, uint64_t value) {
+        dcArgLongLong(vm, static_cast<DClonglong>(value));
+    }
+
+    static void push_float(DCCallVM* vm, DCstruct*, uint64_t value) {
+        register_value_alias_t alias {};
+        alias.qw = value;
+        dcArgFloat(vm, alias.dwf);
+    }
+
+    static void push_double(DCCallVM* vm, DCstruct*, uint64_t value) {
         register_value_alias_t alias {};
         alias.qw = value;
+        dcArgDouble(vm, alias.qwf);
+    }
+
+    static void push_pointer(DCCallVM* vm, DCstruct*, uint64_t value) {
+        dcArgPointer(vm, reinterpret_cast<DCpointer>(value));
+    }
+
+    static void push_struct(DCCallVM* vm, DCstruct* layout, uint64_t value) {
+        dcArgStruct(vm, layout, reinterpret_cast<DCpointer>(value));
+    }
 
-        switch (param.type) {
+    static ffi_argument_handler_t argument_handler(ffi_types_t type) {
+        switch (type) {
             case ffi_types_t::any_type:
             case ffi_types_t::void_type:
-                break;
+                return push_nothing;
             case ffi_types_t::bool_type:
-                dcArgBool(_vm, static_cast<DCbool>(value));
-                break;
+                return push_bool;
             case ffi_types_t::char_type:
-                dcArgChar(_vm, static_cast<DCchar>(value));
-                break;
+                return push_char;
             case ffi_types_t::short_type:
-                dcArgShort(_vm, static_cast<DCshort>(value));
-                break;
+                return push_short;
             case ffi_types_t::long_type:
-                dcArgLong(_vm, static_cast<DClong>(value));
-                break;
+                return push_long;
             case ffi_types_t::long_long_type:
-                dcArgLongLong(_vm, static_cast<DClonglong>(value));
-                break;
+                return push_long_long;
             case ffi_types_t::float_type:
-                dcArgFloat(_vm, alias.dwf);
-                break;
+                return push_float;
             case ffi_types_t::double_type:
-                dcArgDouble(_vm, alias.qwf);
-                break;
+                return push_double;
             case ffi_types_t::pointer_type:
-                dcArgPointer(
-                    _vm,
-                    reinterpret_cast<DCpointer>(value));
-                break;
-            case ffi_types_t::struct_type: {
-                auto meta_struct = make_struct(param);
-                dcArgStruct(
-                    _vm,
-                    meta_struct,
-                    reinterpret_cast<DCpointer>(value));
-                break;
-            }
+                return push_pointer;
+            case ffi_types_t::struct_type:
+                return push_struct;
             default:
-            case ffi_types_t::int_type: {
-                dcArgInt(_vm, static_cast<DCint>(value));
-                break;
-            }
+            case ffi_types_t::int_type:
+                return push_int;
         }
     }
 
+    static uint64_t call_void(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        dcCallVoid(vm, plan.func_ptr);
+        return 0;
+    }
+
+    static uint64_t call_bool(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        return static_cast<uint64_t>(dcCallBool(vm, plan.func_ptr));
+    }
+
+    static uint64_t call_char(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        return static_cast<uint64_t>(dcCallChar(vm, plan.func_ptr));
+    }
+
+    static uint64_t call_short(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        return static_cast<uint64_t>(dcCallShort(vm, plan.func_ptr));
+    }
+
+    static uint64_t call_int(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        return static_cast<uint64_t>(dcCallInt(vm, plan.func_ptr));
+    }
+
+    static uint64_t call_long(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        return static_cast<uint64_t>(dcCallLong(vm, plan.func_ptr));
+    }
+
+    static uint64_t call_long_long(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        return static_cast<uint64_t>(dcCallLongLong(vm, plan.func_ptr));
+    }
+
+    static uint64_t call_float(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        return static_cast<uint64_t>(dcCallFloat(vm, plan.func_ptr));
+    }
+
+    static uint64_t call_double(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        return static_cast<uint64_t>(dcCallDouble(vm, plan.func_ptr));
+    }
+
+    static uint64_t call_pointer(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        return reinterpret_cast<uint64_t>(dcCallPointer(vm, plan.func_ptr));
+    }
+
+    static uint64_t call_struct(DCCallVM* vm, const ffi_call_plan_t& plan) {
+        DCpointer output_value;
+        dcCallStruct(vm, plan.func_ptr, plan.return_layout, &output_value);
+        return reinterpret_cast<uint64_t>(output_value);
+    }
+
+    static uint64_t call_nothing(DCCallVM*, const ffi_call_plan_t&) {
+        return 0;
+    }
+
+    static ffi_return_handler_t return_handler(ffi_types_t type) {
+        switch (type) {
+            case ffi_types_t::void_type:
+                return call_void;
+            case ffi_types_t::bool_type:
+                return call_bool;
+            case ffi_types_t::char_type:
+                return call_char;
+            case ffi_types_t::short_type:
+                return call_short;
+            case ffi_types_t::int_type:
+                return call_int;
+            case ffi_types_t::long_type:
+                return call_long;
+            case ffi_types_t::long_long_type:
+                return call_long_long;
+            case ffi_types_t::float_type:
+                return call_float;
+            case ffi_types_t::double_type:
+                return call_double;
+            case ffi_types_t::pointer_type:
+                return call_pointer;
+            case ffi_types_t::struct_type:
+                return call_struct;
+            default:
+                return call_nothing;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    ffi::ffi(
+        size_t heap_size,
+        const ffi* shared_plans) : _heap_size(heap_size),
+                                   _shared_plans(shared_plans) {
+    }
+
+    ffi::~ffi() {
+        clear();
+        dcFree(_vm);
+        _vm = nullptr;
+    }
+
+    void ffi::push(
+            const ffi_argument_step_t& step,
+            uint64_t value) {
+        step.push(_vm, step.layout, value);
+    }
+
     void ffi::clear() {
+        for (auto& kvp : _call_plans)
+            free_call_plan(kvp.second);
+        for (auto& kvp : _call_site_plans)
+            free_call_plan(kvp.second);
+        _call_plans.clear();
+        _call_site_plans.clear();
         _foreign_functions.clear();
         _shared_libraries.clear();
     }
 
+    size_t ffi::heap_size() const {
+        return _heap_size;
+    }
+
     void ffi::reset() {
         dcReset(_vm);
     }
@@ -105,9 +231,60 @@ namespace basecode::vm {
         signature.func_ptr = func_ptr;
         _foreign_functions.insert(std::make_pair(func_ptr, signature));
 
+        auto& plan = _call_plans[func_ptr];
+        build_call_plan(signature, signature.arguments, plan);
+
         return true;
     }
 
+    void ffi::register_call_site(
+            function_signature_t* signature,
+            common::id_t call_site_id,
+            const function_value_list_t& arguments) {
+        signature->call_site_arguments.insert(std::make_pair(call_site_id, arguments));
+
+        auto& plan = _call_site_plans[call_site_id];
+        free_call_plan(plan);
+        build_call_plan(*signature, arguments, plan);
+    }
+
+    void ffi::build_call_plan(
+            const function_signature_t& signature,
+            const function_value_list_t& arguments,
+            ffi_call_plan_t& plan) {
+        plan.func_ptr = signature.func_ptr;
+        plan.is_variadic = signature.is_variadic();
+        plan.calling_mode = signature.calling_mode;
+        plan.return_type = signature.return_value.type;
+        plan.call = return_handler(plan.return_type);
+        if (plan.return_type == ffi_types_t::struct_type)
+            plan.return_layout = make_struct(signature.return_value);
+
+        plan.arguments.clear();
+        plan.arguments.reserve(arguments.size());
+        for (const auto& arg : arguments) {
+            ffi_argument_step_t step {};
+            step.push = argument_handler(arg.type);
+            if (arg.type == ffi_types_t::struct_type)
+                step.layout = make_struct(arg);
+            plan.arguments.push_back(step);
+        }
+    }
+
+    void ffi::free_call_plan(ffi_call_plan_t& plan) {
+        if (plan.return_layout != nullptr) {
+            dcFreeStruct(plan.return_layout);
+            plan.return_layout = nullptr;
+        }
+        for (auto& step : plan.arguments) {
+            if (step.layout != nullptr) {
+                dcFreeStruct(step.layout);
+                step.layout = nullptr;
+            }
+        }
+        plan.arguments.clear();
+    }
+
     void ffi::add_struct_fields(
             DCstruct* s,
             const std::vector<function_value_t>& fields) {
@@ -173,6 +350,7 @@ namespace basecode::vm {
 
     bool ffi::initialize(common::result& r) {
         _vm = dcNewCallVM(_heap_size);
+        calling_convention(ffi_calling_mode_t::c_default);
         _shared_libraries.clear();
         return true;
     }
@@ -195,84 +373,18 @@ namespace basecode::vm {
         return &(*pair.first).second;
     }
 
-    uint64_t ffi::call(function_signature_t* func) {
-        switch (func->return_value.type) {
-            case ffi_types_t::void_type: {
-                dcCallVoid(_vm, func->func_ptr);
-                return 0;
-            }
-            case ffi_types_t::bool_type: {
-                auto value = static_cast<uint64_t>(dcCallBool(
-                    _vm,
-                    func->func_ptr));
-                return value;
-            }
-            case ffi_types_t::char_type: {
-                auto value = static_cast<uint64_t>(dcCallChar(
-                    _vm,
-                    func->func_ptr));
-                return value;
-            }
-            case ffi_types_t::short_type: {
-                auto value = static_cast<uint64_t>(dcCallShort(
-                    _vm,
-                    func->func_ptr));
-                return value;
-            }
-            case ffi_types_t::int_type: {
-                auto value = static_cast<uint64_t>(dcCallInt(
-                    _vm,
-                    func->func_ptr));
-                return value;
-            }
-            case ffi_types_t::long_type: {
-                auto value = static_cast<uint64_t>(dcCallLong(
-                    _vm,
-                    func->func_ptr));
-                return value;
-            }
-            case ffi_types_t::long_long_type: {
-                auto value = static_cast<uint64_t>(dcCallLongLong(
-                    _vm,
-                    func->func_ptr));
-                return value;
-            }
-            case ffi_types_t::float_type: {
-                auto value = static_cast<uint64_t>(dcCallFloat(
-                    _vm,
-                    func->func_ptr));
-                return value;
-            }
-            case ffi_types_t::double_type: {
-                auto value = static_cast<uint64_t>(dcCallDouble(
-                    _vm,
-                    func->func_ptr));
-                return value;
-            }
-            case ffi_types_t::pointer_type: {
-                auto value = reinterpret_cast<uint64_t>(dcCallPointer(
-                    _vm,
-                    func->func_ptr));
-                return value;
-            }
-            default:
-                return 0;
-            case ffi_types_t::struct_type: {
-                auto dc_struct = make_struct(func->return_value);
-
-                DCpointer output_value;
-                dcCallStruct(
-                    _vm,
-                    func->func_ptr,
-                    dc_struct,
-                    &output_value);
-
-                return reinterpret_cast<uint64_t>(output_value);
-            }
-        }
+    void ffi::begin_call(const ffi_call_plan_t& plan) {
+        dcReset(_vm);
+        if (plan.calling_mode != _calling_mode)
+            calling_convention(plan.calling_mode);
+    }
+
+    uint64_t ffi::call(const ffi_call_plan_t& plan) {
+        return plan.call(_vm, plan);
     }
 
     void ffi::calling_convention(ffi_calling_mode_t mode) {
+        _calling_mode = mode;
         switch (mode) {
             case ffi_calling_mode_t::c_default:
                 dcMode(_vm, DC_CALL_C_DEFAULT);
@@ -301,6 +413,25 @@ namespace basecode::vm {
         return &it->second;
     }
 
+    const ffi_call_plan_t* ffi::find_call_plan(
+            uint64_t address,
+            common::id_t call_site_id) const {
+        if (_shared_plans != nullptr)
+            return _shared_plans->find_call_plan(address, call_site_id);
+
+        auto it = _call_plans.find(reinterpret_cast<void*>(address));
+        if (it == _call_plans.end())
+            return nullptr;
+
+        if (!it->second.is_variadic)
+            return &it->second;
+
+        auto site_it = _call_site_plans.find(call_site_id);
+        if (site_it == _call_site_plans.end())
+            return nullptr;
+        return &site_it->second;
+    }
+
     shared_library_t* ffi::shared_library(const boost::filesystem::path& path) {
         auto it = _shared_libraries.find(path.string());
         if (it == _shared_libraries.end())
@@ -15,9 +15,46 @@
 
 namespace basecode::vm {
 
+    using ffi_argument_handler_t = void (*)(
+        DCCallVM* vm,
+        DCstruct* layout,
+        uint64_t value);
+
+    using ffi_return_handler_t = uint64_t (*)(
+        DCCallVM* vm,
+        const ffi_call_plan_t& plan);
+
+    // one step of a plan's argument marshalling program: the handler pushes a
+    // single popped value as its argument type
+    struct ffi_argument_step_t {
+        ffi_argument_handler_t push = nullptr;
+        DCstruct* layout = nullptr;
+    };
+
+    // everything a call needs that only depends on the signature, resolved
+    // once at registration: the dyncall struct layouts, one step per
+    // argument and the handler for the return type.  variadic functions get
+    // a plan per call site, keyed by the id the ffi instruction carries.
+    struct ffi_call_plan_t {
+        void* func_ptr = nullptr;
+        bool is_variadic = false;
+        DCstruct* return_layout = nullptr;
+        ffi_return_handler_t call = nullptr;
+        ffi_types_t return_type = ffi_types_t::void_type;
+        ffi_calling_mode_t calling_mode = ffi_calling_mode_t::c_default;
+        std::vector<ffi_argument_step_t> arguments {};
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+
     class ffi {
     public:
-        explicit ffi(size_t heap_size);
+        // an ffi built with shared_plans looks call plans up in that ffi
+        // but calls through its own call vm, so each thread of a terp_pool
+        // can make foreign calls on its own
+        explicit ffi(
+            size_t heap_size,
+            const ffi* shared_plans = nullptr);
 
         virtual ~ffi();
 
@@ -29,6 +66,13 @@ namespace basecode::vm {
             common::result& r,
             function_signature_t& signature);
 
+        void register_call_site(
+            function_signature_t* signature,
+            common::id_t call_site_id,
+            const function_value_list_t& arguments);
+
+        size_t heap_size() const;
+
         void dump_shared_libraries();
 
         bool initialize(common::result& r);
@@ -37,16 +81,20 @@ namespace basecode::vm {
             common::result& r,
             const boost::filesystem::path& path);
 
-        uint64_t call(function_signature_t* func);
+        void begin_call(const ffi_call_plan_t& plan);
+
+        uint64_t call(const ffi_call_plan_t& plan);
 
         void push(
-            const function_value_t& param,
+            const ffi_argument_step_t& step,
             uint64_t value);
 
-        void calling_convention(ffi_calling_mode_t mode);
-
         function_signature_t* find_function(uint64_t address);
 
+        const ffi_call_plan_t* find_call_plan(
+            uint64_t address,
+            common::id_t call_site_id) const;
+
         shared_library_t* shared_library(const boost::filesystem::path& path);
 
     private:
@@ -56,9 +104,22 @@ namespace basecode::vm {
 
         DCstruct* make_struct(const function_value_t& value);
 
+        void free_call_plan(ffi_call_plan_t& plan);
+
+        void calling_convention(ffi_calling_mode_t mode);
+
+        void build_call_plan(
+            const function_signature_t& signature,
+            const function_value_list_t& arguments,
+            ffi_call_plan_t& plan);
+
     private:
         size_t _heap_size;
         DCCallVM* _vm = nullptr;
+        const ffi* _shared_plans = nullptr;
+        ffi_calling_mode_t _calling_mode {};
+        std::unordered_map<void*, ffi_call_plan_t> _call_plans {};
+        std::unordered_map<common::id_t, ffi_call_plan_t> _call_site_plans {};
         std::unordered_map<void*, function_signature_t> _foreign_functions {};
         std::unordered_map<std::string, shared_library_t> _shared_libraries {};
     };
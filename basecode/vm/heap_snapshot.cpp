@@ -0,0 +1,142 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <fmt/format.h>
+#include "heap_snapshot.h"
+
+namespace basecode::vm {
+
+    static int create_memory_file() {
+#if defined(__linux__)
+        return memfd_create("basecode-heap-snapshot", MFD_CLOEXEC);
+#else
+        char path[] = "/tmp/basecode-heap-snapshot-XXXXXX";
+        auto fd = mkstemp(path);
+        if (fd != -1)
+            unlink(path);
+        return fd;
+#endif
+    }
+
+    static bool is_zero_page(
+            const uint8_t* page,
+            size_t size) {
+        auto words = reinterpret_cast<const uint64_t*>(page);
+        for (size_t i = 0; i < size / sizeof(uint64_t); i++) {
+            if (words[i] != 0)
+                return false;
+        }
+        return true;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    heap_snapshot::~heap_snapshot() {
+        clear();
+    }
+
+    void heap_snapshot::clear() {
+        if (_fd != -1) {
+            close(_fd);
+            _fd = -1;
+        }
+        _size = 0;
+        _resident_size = 0;
+        _allocator_state.clear();
+    }
+
+    bool heap_snapshot::empty() const {
+        return _fd == -1;
+    }
+
+    size_t heap_snapshot::size() const {
+        return _size;
+    }
+
+    size_t heap_snapshot::resident_size() const {
+        return _resident_size;
+    }
+
+    bool heap_snapshot::map(
+            common::result& r,
+            uint8_t* heap) const {
+        auto address = mmap(
+            heap,
+            _size,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_FIXED,
+            _fd,
+            0);
+        if (address == MAP_FAILED) {
+            r.error(
+                "B081",
+                fmt::format("unable to map heap snapshot: ${:016X}", reinterpret_cast<uint64_t>(heap)));
+            return false;
+        }
+        return true;
+    }
+
+    // untouched heap pages read as the shared zero page, so scanning them
+    // doesn't fault anything in.  the memory file stays sparse where the
+    // heap is zero.
+    bool heap_snapshot::write(
+            common::result& r,
+            const uint8_t* heap,
+            size_t size) {
+        clear();
+
+        _fd = create_memory_file();
+        if (_fd == -1 || ftruncate(_fd, static_cast<off_t>(size)) != 0) {
+            r.error("B080", "unable to create heap snapshot.");
+            clear();
+            return false;
+        }
+        _size = size;
+
+        auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        size_t offset = 0;
+        while (offset < size) {
+            if (is_zero_page(heap + offset, page_size)) {
+                offset += page_size;
+                continue;
+            }
+
+            auto end = offset + page_size;
+            while (end < size && !is_zero_page(heap + end, page_size))
+                end += page_size;
+
+            auto run_offset = offset;
+            while (run_offset < end) {
+                auto written = pwrite(
+                    _fd,
+                    heap + run_offset,
+                    end - run_offset,
+                    static_cast<off_t>(run_offset));
+                if (written <= 0) {
+                    r.error("B080", "unable to write heap snapshot.");
+                    clear();
+                    return false;
+                }
+                run_offset += static_cast<size_t>(written);
+            }
+
+            _resident_size += end - offset;
+            offset = end;
+        }
+
+        return true;
+    }
+
+};
@@ -0,0 +1,67 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "terp.h"
+
+namespace basecode::vm {
+
+    // a terp's heap, register file, allocator bookkeeping and ffi address
+    // regions at one point in time.  the heap is written into an anonymous
+    // memory file, skipping pages that are all zero.  restoring maps that
+    // file privately over the terp's heap, so a restore doesn't copy
+    // anything: each page is shared with the snapshot until byte code
+    // writes to it.  a snapshot can be restored any number of times.
+    class heap_snapshot {
+    public:
+        heap_snapshot() = default;
+
+        heap_snapshot(const heap_snapshot&) = delete;
+
+        heap_snapshot& operator=(const heap_snapshot&) = delete;
+
+        ~heap_snapshot();
+
+        void clear();
+
+        bool empty() const;
+
+        size_t size() const;
+
+        // bytes of the heap actually held by the snapshot
+        size_t resident_size() const;
+
+    private:
+        friend class terp;
+
+        bool map(
+            common::result& r,
+            uint8_t* heap) const;
+
+        bool write(
+            common::result& r,
+            const uint8_t* heap,
+            size_t size);
+
+    private:
+        int _fd = -1;
+        size_t _size = 0;
+        bool _exited = false;
+        size_t _resident_size = 0;
+        uint64_t _current_fiber = 0;
+        register_file_t _registers {};
+        vector_register_file_t _vector_registers {};
+        allocator_state_t _allocator_state {};
+        address_region_table _address_regions {};
+    };
+
+};
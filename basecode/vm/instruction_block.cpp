@@ -74,6 +74,8 @@ namespace basecode::vm {
                 op.type = operand_encoding_t::flags::reg;
                 if (reg.type == register_type_t::integer)
                     op.type |= operand_encoding_t::flags::integer;
+                else if (reg.type == register_type_t::vector)
+                    op.type |= operand_encoding_t::flags::vector;
                 break;
             }
             case instruction_operand_type_t::empty: {
@@ -601,6 +603,142 @@ namespace basecode::vm {
         make_block_entry(op);
     }
 
+    // fibers
+    void instruction_block::fiber(
+            const instruction_operand_t& dest,
+            const instruction_operand_t& entry,
+            const instruction_operand_t& stack_size) {
+        instruction_t op;
+        op.size = op_sizes::qword;
+        op.operands_count = 3;
+        op.op = op_codes::fiber;
+        apply_operand(dest, op, 0);
+        apply_operand(entry, op, 1);
+        apply_operand(stack_size, op, 2);
+        make_block_entry(op);
+    }
+
+    void instruction_block::yield(const instruction_operand_t& value) {
+        instruction_t op;
+        op.size = value.size();
+        op.operands_count = 1;
+        op.op = op_codes::yield;
+        apply_operand(value, op, 0);
+        make_block_entry(op);
+    }
+
+    void instruction_block::resume(
+            const instruction_operand_t& dest,
+            const instruction_operand_t& fiber) {
+        instruction_t op;
+        op.size = dest.size();
+        op.operands_count = 2;
+        op.op = op_codes::resume;
+        apply_operand(dest, op, 0);
+        apply_operand(fiber, op, 1);
+        make_block_entry(op);
+    }
+
+    // vector variations
+    void instruction_block::vload(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& address,
+            const instruction_operand_t& offset) {
+        instruction_t op;
+        op.size = size;
+        op.op = op_codes::vload;
+        op.operands_count = static_cast<uint8_t>(offset.is_empty() ? 2 : 3);
+        apply_operand(dest, op, 0);
+        apply_operand(address, op, 1);
+        apply_operand(offset, op, 2);
+        make_block_entry(op);
+    }
+
+    void instruction_block::vstore(
+            op_sizes size,
+            const instruction_operand_t& address,
+            const instruction_operand_t& src,
+            const instruction_operand_t& offset) {
+        instruction_t op;
+        op.size = size;
+        op.op = op_codes::vstore;
+        op.operands_count = static_cast<uint8_t>(offset.is_empty() ? 2 : 3);
+        apply_operand(address, op, 0);
+        apply_operand(src, op, 1);
+        apply_operand(offset, op, 2);
+        make_block_entry(op);
+    }
+
+    void instruction_block::vbroadcast(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& value) {
+        make_vector(op_codes::vbroadcast, size, dest, value);
+    }
+
+    void instruction_block::vadd(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs) {
+        make_vector(op_codes::vadd, size, dest, lhs, rhs);
+    }
+
+    void instruction_block::vsub(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs) {
+        make_vector(op_codes::vsub, size, dest, lhs, rhs);
+    }
+
+    void instruction_block::vmul(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs) {
+        make_vector(op_codes::vmul, size, dest, lhs, rhs);
+    }
+
+    void instruction_block::vfadd(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs) {
+        make_vector(op_codes::vfadd, size, dest, lhs, rhs);
+    }
+
+    void instruction_block::vfsub(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs) {
+        make_vector(op_codes::vfsub, size, dest, lhs, rhs);
+    }
+
+    void instruction_block::vfmul(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs) {
+        make_vector(op_codes::vfmul, size, dest, lhs, rhs);
+    }
+
+    void instruction_block::vreduce(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& src) {
+        make_vector(op_codes::vreduce, size, dest, src);
+    }
+
+    void instruction_block::vfreduce(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& src) {
+        make_vector(op_codes::vfreduce, size, dest, src);
+    }
+
     // convert
     void instruction_block::convert(
             const instruction_operand_t& dest,
@@ -891,6 +1029,22 @@ namespace basecode::vm {
         make_block_entry(op);
     }
 
+    void instruction_block::make_vector(
+            op_codes code,
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs) {
+        instruction_t op;
+        op.op = code;
+        op.size = size;
+        op.operands_count = static_cast<uint8_t>(rhs.is_empty() ? 2 : 3);
+        apply_operand(dest, op, 0);
+        apply_operand(lhs, op, 1);
+        apply_operand(rhs, op, 2);
+        make_block_entry(op);
+    }
+
     // bz & bnz
     void instruction_block::bz(
             const instruction_operand_t& src,
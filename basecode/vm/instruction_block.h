@@ -158,6 +158,82 @@ namespace basecode::vm {
 
         void free(const instruction_operand_t& addr);
 
+        // fibers
+        void fiber(
+            const instruction_operand_t& dest,
+            const instruction_operand_t& entry,
+            const instruction_operand_t& stack_size);
+
+        void yield(const instruction_operand_t& value);
+
+        void resume(
+            const instruction_operand_t& dest,
+            const instruction_operand_t& fiber);
+
+        // vector variations
+        void vload(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& address,
+            const instruction_operand_t& offset = {});
+
+        void vstore(
+            op_sizes size,
+            const instruction_operand_t& address,
+            const instruction_operand_t& src,
+            const instruction_operand_t& offset = {});
+
+        void vbroadcast(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& value);
+
+        void vadd(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs);
+
+        void vsub(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs);
+
+        void vmul(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs);
+
+        void vfadd(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs);
+
+        void vfsub(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs);
+
+        void vfmul(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs);
+
+        void vreduce(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& src);
+
+        void vfreduce(
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& src);
+
         // convert
         void convert(
             const instruction_operand_t& dest,
@@ -427,6 +503,13 @@ namespace basecode::vm {
             op_sizes size,
             const instruction_operand_t& dest);
 
+        void make_vector(
+            op_codes code,
+            op_sizes size,
+            const instruction_operand_t& dest,
+            const instruction_operand_t& lhs,
+            const instruction_operand_t& rhs = {});
+
         bool apply_operand(
             const instruction_operand_t& operand,
             instruction_t& encoding,
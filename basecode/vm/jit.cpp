@@ -0,0 +1,273 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#include <cstring>
+#include <configure.h>
+#include "jit.h"
+
+#if JIT_ENABLED
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+namespace basecode::vm {
+
+    static inline uint8_t low_bits(x64_registers_t reg) {
+        return static_cast<uint8_t>(static_cast<uint8_t>(reg) & 0x07);
+    }
+
+    static inline bool is_extended(x64_registers_t reg) {
+        return static_cast<uint8_t>(reg) >= 8;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    void x64_emitter::ret() {
+        emit_u8(0xc3);
+    }
+
+    void x64_emitter::clear() {
+        _code.clear();
+    }
+
+    size_t x64_emitter::offset() const {
+        return _code.size();
+    }
+
+    size_t x64_emitter::jmp_rel32() {
+        emit_u8(0xe9);
+        auto at = offset();
+        emit_u32(0);
+        return at;
+    }
+
+    const uint8_t* x64_emitter::data() const {
+        return _code.data();
+    }
+
+    void x64_emitter::call(x64_registers_t reg) {
+        if (is_extended(reg))
+            emit_u8(0x41);
+        emit_u8(0xff);
+        emit_u8(static_cast<uint8_t>(0xd0 | low_bits(reg)));
+    }
+
+    void x64_emitter::push(x64_registers_t reg) {
+        if (is_extended(reg))
+            emit_u8(0x41);
+        emit_u8(static_cast<uint8_t>(0x50 | low_bits(reg)));
+    }
+
+    void x64_emitter::pop(x64_registers_t reg) {
+        if (is_extended(reg))
+            emit_u8(0x41);
+        emit_u8(static_cast<uint8_t>(0x58 | low_bits(reg)));
+    }
+
+    size_t x64_emitter::jcc_rel32(x64_conditions_t condition) {
+        emit_u8(0x0f);
+        emit_u8(static_cast<uint8_t>(0x80 | static_cast<uint8_t>(condition)));
+        auto at = offset();
+        emit_u32(0);
+        return at;
+    }
+
+    void x64_emitter::patch_rel32(size_t at, size_t target) {
+        auto displacement = static_cast<uint32_t>(
+            static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + sizeof(uint32_t))));
+        memcpy(_code.data() + at, &displacement, sizeof(uint32_t));
+    }
+
+    void x64_emitter::mov(x64_registers_t reg, uint64_t value) {
+        emit_u8(static_cast<uint8_t>(0x48 | (is_extended(reg) ? 0x01 : 0x00)));
+        emit_u8(static_cast<uint8_t>(0xb8 | low_bits(reg)));
+        emit_u64(value);
+    }
+
+    void x64_emitter::mov(x64_registers_t dest, x64_registers_t src) {
+        emit_u8(static_cast<uint8_t>(0x48
+            | (is_extended(src) ? 0x04 : 0x00)
+            | (is_extended(dest) ? 0x01 : 0x00)));
+        emit_u8(0x89);
+        emit_u8(static_cast<uint8_t>(0xc0 | (low_bits(src) << 3) | low_bits(dest)));
+    }
+
+    void x64_emitter::imul(x64_registers_t dest, x64_registers_t src) {
+        emit_rex(true, dest, src);
+        emit_u8(0x0f);
+        emit_u8(0xaf);
+        emit_u8(static_cast<uint8_t>(0xc0 | (low_bits(dest) << 3) | low_bits(src)));
+    }
+
+    void x64_emitter::test(x64_registers_t reg, size_t width) {
+        if (width == 2)
+            emit_u8(0x66);
+        emit_rex(width == 8, reg, reg, width == 1 && static_cast<uint8_t>(reg) >= 4);
+        emit_u8(width == 1 ? 0x84 : 0x85);
+        emit_u8(static_cast<uint8_t>(0xc0 | (low_bits(reg) << 3) | low_bits(reg)));
+    }
+
+    void x64_emitter::alu(
+            x64_alu_ops_t op,
+            x64_registers_t dest,
+            x64_registers_t src) {
+        emit_rex(true, src, dest);
+        emit_u8(static_cast<uint8_t>((static_cast<uint8_t>(op) << 3) | 0x01));
+        emit_u8(static_cast<uint8_t>(0xc0 | (low_bits(src) << 3) | low_bits(dest)));
+    }
+
+    void x64_emitter::alu(
+            x64_alu_ops_t op,
+            x64_registers_t dest,
+            int32_t value) {
+        emit_rex(true, x64_registers_t::rax, dest);
+        emit_u8(0x81);
+        emit_u8(static_cast<uint8_t>(0xc0 | (static_cast<uint8_t>(op) << 3) | low_bits(dest)));
+        emit_u32(static_cast<uint32_t>(value));
+    }
+
+    void x64_emitter::load(
+            x64_registers_t dest,
+            x64_registers_t base,
+            int32_t displacement,
+            size_t width) {
+        emit_rex(width == 8, dest, base);
+        switch (width) {
+            case 1: {
+                emit_u8(0x0f);
+                emit_u8(0xb6);
+                break;
+            }
+            case 2: {
+                emit_u8(0x0f);
+                emit_u8(0xb7);
+                break;
+            }
+            default: {
+                emit_u8(0x8b);
+                break;
+            }
+        }
+        emit_memory_operand(dest, base, displacement);
+    }
+
+    void x64_emitter::store(
+            x64_registers_t base,
+            int32_t displacement,
+            x64_registers_t src,
+            size_t width) {
+        if (width == 2)
+            emit_u8(0x66);
+        emit_rex(width == 8, src, base, width == 1 && static_cast<uint8_t>(src) >= 4);
+        emit_u8(width == 1 ? 0x88 : 0x89);
+        emit_memory_operand(src, base, displacement);
+    }
+
+    void x64_emitter::emit_rex(
+            bool wide,
+            x64_registers_t reg,
+            x64_registers_t base,
+            bool required) {
+        uint8_t rex = 0x40;
+        if (wide)
+            rex |= 0x08;
+        if (is_extended(reg))
+            rex |= 0x04;
+        if (is_extended(base))
+            rex |= 0x01;
+        if (rex != 0x40 || required)
+            emit_u8(rex);
+    }
+
+    void x64_emitter::emit_memory_operand(
+            x64_registers_t reg,
+            x64_registers_t base,
+            int32_t displacement) {
+        emit_u8(static_cast<uint8_t>(0x80 | (low_bits(reg) << 3) | low_bits(base)));
+        emit_u32(static_cast<uint32_t>(displacement));
+    }
+
+    void x64_emitter::emit_u8(uint8_t value) {
+        _code.push_back(value);
+    }
+
+    void x64_emitter::emit_u32(uint32_t value) {
+        for (size_t i = 0; i < sizeof(uint32_t); i++)
+            emit_u8(static_cast<uint8_t>(value >> (i * 8)));
+    }
+
+    void x64_emitter::emit_u64(uint64_t value) {
+        for (size_t i = 0; i < sizeof(uint64_t); i++)
+            emit_u8(static_cast<uint8_t>(value >> (i * 8)));
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    native_code_buffer::~native_code_buffer() {
+        reset();
+    }
+
+    bool native_code_buffer::is_supported() {
+        return JIT_ENABLED != 0;
+    }
+
+    void native_code_buffer::reset() {
+#if JIT_ENABLED
+        if (_base != nullptr)
+            munmap(_base, _capacity);
+#endif
+        _base = nullptr;
+        _size = 0;
+        _capacity = 0;
+    }
+
+    size_t native_code_buffer::size() const {
+        return _size;
+    }
+
+    const void* native_code_buffer::write(const uint8_t* code, size_t size) {
+#if JIT_ENABLED
+        if (_base == nullptr) {
+            auto base = mmap(
+                nullptr,
+                default_capacity,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS,
+                -1,
+                0);
+            if (base == MAP_FAILED)
+                return nullptr;
+            _base = reinterpret_cast<uint8_t*>(base);
+            _capacity = default_capacity;
+        }
+
+        if (size == 0 || _capacity - _size < size)
+            return nullptr;
+
+        auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        auto first_page = _size & ~(page_size - 1);
+        auto last_page = (_size + size + page_size - 1) & ~(page_size - 1);
+        if (mprotect(_base + first_page, last_page - first_page, PROT_READ | PROT_WRITE) != 0)
+            return nullptr;
+
+        auto entry = _base + _size;
+        memcpy(entry, code, size);
+        _size = (_size + size + 15) & ~static_cast<size_t>(15);
+
+        if (mprotect(_base + first_page, last_page - first_page, PROT_READ | PROT_EXEC) != 0)
+            return nullptr;
+        return entry;
+#else
+        return nullptr;
+#endif
+    }
+
+};
@@ -0,0 +1,169 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace basecode::vm {
+
+    enum class x64_registers_t : uint8_t {
+        rax,
+        rcx,
+        rdx,
+        rbx,
+        rsp,
+        rbp,
+        rsi,
+        rdi,
+        r8,
+        r9,
+        r10,
+        r11,
+        r12,
+        r13,
+        r14,
+        r15
+    };
+
+    enum class x64_conditions_t : uint8_t {
+        below       = 0x02,
+        above_equal = 0x03,
+        zero        = 0x04,
+        not_zero    = 0x05,
+        below_equal = 0x06,
+        above       = 0x07
+    };
+
+    enum class x64_alu_ops_t : uint8_t {
+        add = 0,
+        or_op,
+        adc,
+        sbb,
+        and_op,
+        sub,
+        xor_op,
+        cmp
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    // encodes the handful of x86-64 instructions the threaded engine needs
+    // to build native blocks.  relative jumps are emitted with a zero
+    // displacement and patched once the target offset is known.  memory
+    // operands are always [base + disp32], and base can't be rsp or r12.
+    // width is the operand size in bytes: 1, 2, 4 or 8.
+    class x64_emitter {
+    public:
+        x64_emitter() = default;
+
+        void ret();
+
+        void clear();
+
+        size_t offset() const;
+
+        size_t jmp_rel32();
+
+        const uint8_t* data() const;
+
+        void call(x64_registers_t reg);
+
+        void push(x64_registers_t reg);
+
+        void pop(x64_registers_t reg);
+
+        size_t jcc_rel32(x64_conditions_t condition);
+
+        void patch_rel32(size_t at, size_t target);
+
+        void mov(x64_registers_t reg, uint64_t value);
+
+        void mov(x64_registers_t dest, x64_registers_t src);
+
+        void imul(x64_registers_t dest, x64_registers_t src);
+
+        void test(x64_registers_t reg, size_t width);
+
+        void alu(
+            x64_alu_ops_t op,
+            x64_registers_t dest,
+            x64_registers_t src);
+
+        void alu(
+            x64_alu_ops_t op,
+            x64_registers_t dest,
+            int32_t value);
+
+        void load(
+            x64_registers_t dest,
+            x64_registers_t base,
+            int32_t displacement,
+            size_t width);
+
+        void store(
+            x64_registers_t base,
+            int32_t displacement,
+            x64_registers_t src,
+            size_t width);
+
+    private:
+        void emit_u8(uint8_t value);
+
+        void emit_u32(uint32_t value);
+
+        void emit_u64(uint64_t value);
+
+        void emit_rex(
+            bool wide,
+            x64_registers_t reg,
+            x64_registers_t base,
+            bool required = false);
+
+        void emit_memory_operand(
+            x64_registers_t reg,
+            x64_registers_t base,
+            int32_t displacement);
+
+    private:
+        std::vector<uint8_t> _code {};
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    // a single mapping of host memory that holds generated code.  pages are
+    // only writable while code is copied into them and executable otherwise.
+    // space is never reused before reset.
+    class native_code_buffer {
+    public:
+        static constexpr size_t default_capacity = 16 * 1024 * 1024;
+
+        static bool is_supported();
+
+        native_code_buffer() = default;
+
+        ~native_code_buffer();
+
+        void reset();
+
+        size_t size() const;
+
+        const void* write(const uint8_t* code, size_t size);
+
+    private:
+        size_t _size = 0;
+        size_t _capacity = 0;
+        uint8_t* _base = nullptr;
+    };
+
+};
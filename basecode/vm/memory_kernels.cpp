@@ -0,0 +1,209 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#include <cstring>
+#include "memory_kernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace basecode::vm {
+
+    // each kernel writes size bytes of the repeating eight byte image in
+    // pattern.  size is a multiple of the element size, so a partial image
+    // at the end always stops on an element boundary.  the vector kernels
+    // store one unaligned vector and then continue from the next aligned
+    // address with the image rotated to match.
+    using fill_kernel_handler_t = void (*)(
+        uint8_t* dest,
+        uint64_t pattern,
+        size_t size);
+
+    static void fill_scalar(
+            uint8_t* dest,
+            uint64_t pattern,
+            size_t size) {
+        while (size >= sizeof(uint64_t)) {
+            memcpy(dest, &pattern, sizeof(uint64_t));
+            dest += sizeof(uint64_t);
+            size -= sizeof(uint64_t);
+        }
+        memcpy(dest, &pattern, size);
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    // the image that continues the pattern count bytes further along; the
+    // x86-64 hosts these kernels run on are always little endian
+    static uint64_t advance_pattern(uint64_t pattern, size_t count) {
+        auto shift = (count % sizeof(uint64_t)) * 8;
+        if (shift == 0)
+            return pattern;
+        return (pattern >> shift) | (pattern << (64 - shift));
+    }
+
+    static void fill_sse2(
+            uint8_t* dest,
+            uint64_t pattern,
+            size_t size) {
+        auto wide = _mm_set1_epi64x(static_cast<long long>(pattern));
+        auto head = (16 - (reinterpret_cast<uintptr_t>(dest) & 15)) & 15;
+        if (head != 0 && size >= 16 + head) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), wide);
+            dest += head;
+            size -= head;
+            pattern = advance_pattern(pattern, head);
+            wide = _mm_set1_epi64x(static_cast<long long>(pattern));
+        }
+        while (size >= 64) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), wide);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 16), wide);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 32), wide);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + 48), wide);
+            dest += 64;
+            size -= 64;
+        }
+        while (size >= 16) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), wide);
+            dest += 16;
+            size -= 16;
+        }
+        fill_scalar(dest, pattern, size);
+    }
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+    __attribute__((target("avx2")))
+    static void fill_avx2(
+            uint8_t* dest,
+            uint64_t pattern,
+            size_t size) {
+        auto wide = _mm256_set1_epi64x(static_cast<long long>(pattern));
+        auto head = (32 - (reinterpret_cast<uintptr_t>(dest) & 31)) & 31;
+        if (head != 0 && size >= 32 + head) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), wide);
+            dest += head;
+            size -= head;
+            pattern = advance_pattern(pattern, head);
+            wide = _mm256_set1_epi64x(static_cast<long long>(pattern));
+        }
+        while (size >= 128) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), wide);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 32), wide);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 64), wide);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + 96), wide);
+            dest += 128;
+            size -= 128;
+        }
+        while (size >= 32) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest), wide);
+            dest += 32;
+            size -= 32;
+        }
+        _mm256_zeroupper();
+        fill_scalar(dest, pattern, size);
+    }
+#endif
+
+    static fill_kernel_t detect_fill_kernel() {
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return fill_kernel_t::avx2;
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        return fill_kernel_t::sse2;
+#else
+        return fill_kernel_t::scalar;
+#endif
+    }
+
+    static fill_kernel_handler_t fill_kernel_handler(fill_kernel_t kernel) {
+        switch (kernel) {
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+            case fill_kernel_t::avx2:
+                return fill_avx2;
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+            case fill_kernel_t::sse2:
+                return fill_sse2;
+#endif
+            default:
+                return fill_scalar;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    fill_kernel_t fill_kernel() {
+        static const fill_kernel_t s_kernel = detect_fill_kernel();
+        return s_kernel;
+    }
+
+    const char* fill_kernel_name(fill_kernel_t kernel) {
+        switch (kernel) {
+            case fill_kernel_t::sse2:   return "sse2";
+            case fill_kernel_t::avx2:   return "avx2";
+            default:                    return "scalar";
+        }
+    }
+
+    void fill_pattern(
+            void* dest,
+            uint64_t value,
+            size_t element_size,
+            size_t count) {
+        auto size = element_size * count;
+        if (size == 0)
+            return;
+
+        auto byte_value = static_cast<uint8_t>(value);
+        auto word_value = static_cast<uint16_t>(value);
+        auto dword_value = static_cast<uint32_t>(value);
+
+        const void* element = &value;
+        switch (element_size) {
+            case 1: element = &byte_value; break;
+            case 2: element = &word_value; break;
+            case 4: element = &dword_value; break;
+            default: break;
+        }
+
+        uint8_t image[sizeof(uint64_t)];
+        for (size_t i = 0; i < sizeof(uint64_t); i += element_size)
+            memcpy(image + i, element, element_size);
+
+        // libc's memset is already vectorized, so any pattern made of a
+        // single repeated byte (zero-fills included) goes there
+        if (memcmp(image, image + 1, sizeof(uint64_t) - 1) == 0) {
+            memset(dest, image[0], size);
+            return;
+        }
+
+        static const fill_kernel_handler_t s_handler = fill_kernel_handler(fill_kernel());
+
+        uint64_t pattern;
+        memcpy(&pattern, image, sizeof(uint64_t));
+        s_handler(reinterpret_cast<uint8_t*>(dest), pattern, size);
+    }
+
+    void copy_memory(
+            void* dest,
+            const void* source,
+            size_t size) {
+        memmove(dest, source, size);
+    }
+
+};
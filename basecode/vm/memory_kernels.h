@@ -0,0 +1,46 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace basecode::vm {
+
+    enum class fill_kernel_t : uint8_t {
+        scalar,
+        sse2,
+        avx2
+    };
+
+    // the kernel fill_pattern uses on this host.  it's picked once, the
+    // first time it's asked for: avx2 when the cpu reports it, sse2 on any
+    // other x86-64 host and the scalar loop everywhere else.
+    fill_kernel_t fill_kernel();
+
+    const char* fill_kernel_name(fill_kernel_t kernel);
+
+    // writes count copies of the low element_size bytes of value to dest,
+    // in host byte order.  element_size is 1, 2, 4 or 8.
+    void fill_pattern(
+        void* dest,
+        uint64_t value,
+        size_t element_size,
+        size_t count);
+
+    // like memcpy, but the ranges may overlap
+    void copy_memory(
+        void* dest,
+        const void* source,
+        size_t size);
+
+};
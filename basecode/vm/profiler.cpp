@@ -0,0 +1,242 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#include <fstream>
+#include <algorithm>
+#include <fmt/format.h>
+#include <common/string_support.h>
+#include "terp.h"
+#include "profiler.h"
+#include "assembly_listing.h"
+
+namespace basecode::vm {
+
+    struct profile_line_t {
+        size_t line_number = 0;
+        std::string file_name {};
+        std::string source {};
+    };
+
+    struct profile_symbols_t {
+        std::set<uint64_t> procedures {};
+        std::map<uint64_t, std::string> labels {};
+        std::unordered_map<uint64_t, profile_line_t> lines {};
+
+        std::string procedure_name(uint64_t address) const {
+            auto it = procedures.upper_bound(address);
+            if (it == procedures.begin())
+                return fmt::format("${:016X}", address);
+            --it;
+            auto label_it = labels.find(*it);
+            if (label_it == labels.end())
+                return fmt::format("${:016X}", *it);
+            return label_it->second;
+        }
+    };
+
+    static double percent_of(uint64_t count, uint64_t total) {
+        return total == 0 ? 0.0 : (static_cast<double>(count) * 100.0) / total;
+    }
+
+    template <typename T>
+    static std::vector<std::pair<T, uint64_t>> sorted_by_count(
+            const std::unordered_map<T, uint64_t>& counts) {
+        std::vector<std::pair<T, uint64_t>> sorted(counts.begin(), counts.end());
+        std::sort(
+            sorted.begin(),
+            sorted.end(),
+            [](const auto& lhs, const auto& rhs) {
+                if (lhs.second != rhs.second)
+                    return lhs.second > rhs.second;
+                return lhs.first < rhs.first;
+            });
+        return sorted;
+    }
+
+    // the first label at an address names it; the first instruction at an
+    // address is the line its counts are reported against
+    static void build_symbols(
+            const std::set<uint64_t>& entered,
+            vm::assembly_listing& listing,
+            profile_symbols_t& symbols) {
+        symbols.procedures = entered;
+        for (const auto& file_name : listing.file_names()) {
+            auto source_file = listing.source_file(file_name);
+            if (source_file == nullptr)
+                continue;
+
+            for (size_t i = 0; i < source_file->lines.size(); i++) {
+                const auto& line = source_file->lines[i];
+                switch (line.type) {
+                    case listing_source_line_type_t::label: {
+                        auto name = line.source;
+                        common::trim(name);
+                        if (!name.empty() && name.back() == ':')
+                            name.pop_back();
+                        symbols.labels.insert(std::make_pair(line.address, name));
+                        if (name == "_start")
+                            symbols.procedures.insert(line.address);
+                        break;
+                    }
+                    case listing_source_line_type_t::instruction: {
+                        auto source = line.source;
+                        common::trim(source);
+                        symbols.lines.insert(std::make_pair(
+                            line.address,
+                            profile_line_t {i + 1, file_name, source}));
+                        break;
+                    }
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    void profiler::reset() {
+        _instruction_count = 0;
+        _op_counts.fill(0);
+        _stacks.clear();
+        _procedures.clear();
+        _address_counts.clear();
+    }
+
+    uint64_t profiler::instruction_count() const {
+        return _instruction_count;
+    }
+
+    // every frame starts with the caller's fp and then the return address,
+    // see byte_code_emitter.  the walk stops at the first frame pointer
+    // outside of the stack.
+    void profiler::sample(const vm::terp& terp) {
+        const auto& registers = terp.register_file();
+        auto bottom = terp.heap_vector(heap_vectors_t::bottom_of_stack);
+        auto top = terp.heap_vector(heap_vectors_t::top_of_stack);
+
+        std::vector<uint64_t> stack {};
+        stack.push_back(registers.r[register_pc].qw);
+
+        auto fp = registers.r[register_fp].qw;
+        while (fp >= bottom
+           &&  fp + (sizeof(uint64_t) * 2) <= top
+           &&  stack.size() < maximum_stack_depth) {
+            auto return_address = terp.read(op_sizes::qword, fp + sizeof(uint64_t));
+            if (return_address == 0)
+                break;
+            // the return address follows the jsr, so the caller is the
+            // procedure holding the byte before it
+            stack.push_back(return_address - 1);
+
+            auto caller_fp = terp.read(op_sizes::qword, fp);
+            if (caller_fp <= fp)
+                break;
+            fp = caller_fp;
+        }
+
+        ++_stacks[stack];
+    }
+
+    bool profiler::write(
+            common::result& r,
+            const boost::filesystem::path& path,
+            vm::assembly_listing& listing) const {
+        profile_symbols_t symbols {};
+        build_symbols(_procedures, listing, symbols);
+
+        std::ofstream file(path.string());
+        if (!file.is_open()) {
+            r.error("B085", fmt::format("unable to write vm profile: {}", path.string()));
+            return false;
+        }
+
+        std::unordered_map<uint8_t, uint64_t> op_counts {};
+        for (size_t i = 0; i < _op_counts.size(); i++) {
+            if (_op_counts[i] != 0)
+                op_counts.insert(std::make_pair(static_cast<uint8_t>(i), _op_counts[i]));
+        }
+
+        std::unordered_map<std::string, uint64_t> procedure_counts {};
+        for (const auto& kvp : _address_counts)
+            procedure_counts[symbols.procedure_name(kvp.first)] += kvp.second;
+
+        file << fmt::format("instructions executed: {}\n", _instruction_count);
+
+        file << fmt::format("\n{:>14}  {:>7}  {}\n", "COUNT", "PERCENT", "OP CODE");
+        for (const auto& kvp : sorted_by_count(op_counts)) {
+            file << fmt::format(
+                "{:>14}  {:>6.2f}%  {}\n",
+                kvp.second,
+                percent_of(kvp.second, _instruction_count),
+                op_code_name(static_cast<op_codes>(kvp.first)));
+        }
+
+        file << fmt::format("\n{:>14}  {:>7}  {}\n", "COUNT", "PERCENT", "PROCEDURE");
+        for (const auto& kvp : sorted_by_count(procedure_counts)) {
+            file << fmt::format(
+                "{:>14}  {:>6.2f}%  {}\n",
+                kvp.second,
+                percent_of(kvp.second, _instruction_count),
+                kvp.first);
+        }
+
+        file << fmt::format(
+            "\n{:>14}  {:>7}  {:<17}  {:<24}  {}\n",
+            "COUNT",
+            "PERCENT",
+            "ADDRESS",
+            "LINE",
+            "SOURCE");
+        for (const auto& kvp : sorted_by_count(_address_counts)) {
+            std::string location {};
+            std::string source {};
+            auto line_it = symbols.lines.find(kvp.first);
+            if (line_it != symbols.lines.end()) {
+                location = fmt::format(
+                    "{}:{}",
+                    line_it->second.file_name,
+                    line_it->second.line_number);
+                source = line_it->second.source;
+            }
+            file << fmt::format(
+                "{:>14}  {:>6.2f}%  ${:016X}  {:<24}  {}\n",
+                kvp.second,
+                percent_of(kvp.second, _instruction_count),
+                kvp.first,
+                location,
+                source);
+        }
+
+        std::map<std::string, uint64_t> folded_stacks {};
+        for (const auto& kvp : _stacks) {
+            std::string folded {};
+            for (auto it = kvp.first.rbegin(); it != kvp.first.rend(); ++it) {
+                if (!folded.empty())
+                    folded += ";";
+                folded += symbols.procedure_name(*it);
+            }
+            folded_stacks[folded] += kvp.second;
+        }
+
+        auto folded_path = path.string() + ".folded";
+        std::ofstream folded_file(folded_path);
+        if (!folded_file.is_open()) {
+            r.error("B085", fmt::format("unable to write vm profile: {}", folded_path));
+            return false;
+        }
+        for (const auto& kvp : folded_stacks)
+            folded_file << fmt::format("{} {}\n", kvp.first, kvp.second);
+
+        return true;
+    }
+
+};
@@ -0,0 +1,69 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <array>
+#include <boost/filesystem.hpp>
+#include "vm_types.h"
+
+namespace basecode::vm {
+
+    // counts every instruction a terp executes, by op code and by address,
+    // and every sample_interval instructions walks the fp chain to record
+    // a call stack.  procedures are the targets of jsr instructions seen
+    // while running, plus the program's _start label; they're named after
+    // the labels in the assembly listing.
+    //
+    // write produces a flat profile in path and the sampled stacks in
+    // path.folded, one "outer;inner count" line per stack, the input
+    // flamegraph.pl expects.
+    class profiler {
+    public:
+        // prime, so samples don't line up with the period of a loop
+        static constexpr uint64_t sample_interval = 997;
+
+        static constexpr size_t maximum_stack_depth = 256;
+
+        profiler() = default;
+
+        void reset();
+
+        uint64_t instruction_count() const;
+
+        inline bool record(uint64_t address, op_codes op) {
+            ++_op_counts[static_cast<uint8_t>(op)];
+            ++_address_counts[address];
+            return ++_instruction_count % sample_interval == 0;
+        }
+
+        inline void enter(uint64_t address) {
+            _procedures.insert(address);
+        }
+
+        void sample(const vm::terp& terp);
+
+        bool write(
+            common::result& r,
+            const boost::filesystem::path& path,
+            vm::assembly_listing& listing) const;
+
+    private:
+        uint64_t _instruction_count = 0;
+        std::set<uint64_t> _procedures {};
+        std::array<uint64_t, 256> _op_counts {};
+        std::map<std::vector<uint64_t>, uint64_t> _stacks {};
+        std::unordered_map<uint64_t, uint64_t> _address_counts {};
+    };
+
+};
@@ -0,0 +1,651 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fmt/format.h>
+#include "ffi.h"
+#include "terp.h"
+#include "assembler.h"
+#include "program_image.h"
+
+namespace basecode::vm {
+
+    enum program_image_flags_t : uint16_t {
+        run_flag        = 0b0000000000000001,
+        big_endian_flag = 0b0000000000000010,
+    };
+
+    class image_writer {
+    public:
+        void u8(uint8_t value) {
+            bytes(&value, sizeof(value));
+        }
+
+        void u16(uint16_t value) {
+            bytes(&value, sizeof(value));
+        }
+
+        void u32(uint32_t value) {
+            bytes(&value, sizeof(value));
+        }
+
+        void u64(uint64_t value) {
+            bytes(&value, sizeof(value));
+        }
+
+        void align(size_t size) {
+            while (_buffer.size() % size != 0)
+                _buffer.push_back(0);
+        }
+
+        void string(const std::string& value) {
+            u32(static_cast<uint32_t>(value.size()));
+            bytes(value.data(), value.size());
+        }
+
+        void bytes(const void* data, size_t size) {
+            auto begin = reinterpret_cast<const uint8_t*>(data);
+            _buffer.insert(_buffer.end(), begin, begin + size);
+        }
+
+        void function_value(const function_value_t& value) {
+            string(value.name);
+            u8(static_cast<uint8_t>(value.type));
+            function_values(value.fields);
+        }
+
+        void function_values(const function_value_list_t& values) {
+            u32(static_cast<uint32_t>(values.size()));
+            for (const auto& value : values)
+                function_value(value);
+        }
+
+        void patch(size_t offset, uint64_t value) {
+            memcpy(_buffer.data() + offset, &value, sizeof(value));
+        }
+
+        size_t offset() const {
+            return _buffer.size();
+        }
+
+        const std::vector<uint8_t>& buffer() const {
+            return _buffer;
+        }
+
+    private:
+        std::vector<uint8_t> _buffer {};
+    };
+
+    // reads stop at the end of the image: once a read runs past it, every
+    // later read returns zero and failed is set
+    class image_reader {
+    public:
+        image_reader(
+            const uint8_t* data,
+            size_t size) : _data(data),
+                           _size(size) {
+        }
+
+        uint8_t u8() {
+            uint8_t value = 0;
+            bytes(&value, sizeof(value));
+            return value;
+        }
+
+        uint16_t u16() {
+            uint16_t value = 0;
+            bytes(&value, sizeof(value));
+            return value;
+        }
+
+        uint32_t u32() {
+            uint32_t value = 0;
+            bytes(&value, sizeof(value));
+            return value;
+        }
+
+        uint64_t u64() {
+            uint64_t value = 0;
+            bytes(&value, sizeof(value));
+            return value;
+        }
+
+        std::string string() {
+            auto size = u32();
+            if (!available(size))
+                return {};
+            std::string value(reinterpret_cast<const char*>(_data + _offset), size);
+            _offset += size;
+            return value;
+        }
+
+        void bytes(void* data, size_t size) {
+            if (!available(size))
+                return;
+            memcpy(data, _data + _offset, size);
+            _offset += size;
+        }
+
+        bool available(size_t size) {
+            if (_failed || size > _size - _offset) {
+                _failed = true;
+                return false;
+            }
+            return true;
+        }
+
+        function_value_t function_value() {
+            function_value_t value {};
+            value.name = string();
+            value.type = static_cast<ffi_types_t>(u8());
+            value.fields = function_values();
+            return value;
+        }
+
+        function_value_list_t function_values() {
+            function_value_list_t values {};
+            auto count = u32();
+            for (uint32_t i = 0; i < count && !_failed; i++)
+                values.push_back(function_value());
+            return values;
+        }
+
+        bool failed() const {
+            return _failed;
+        }
+
+    private:
+        size_t _offset = 0;
+        bool _failed = false;
+        const uint8_t* _data = nullptr;
+        size_t _size = 0;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    program_image::~program_image() {
+        unmap();
+    }
+
+    bool program_image::run() const {
+        return _run;
+    }
+
+    void program_image::run(bool value) {
+        _run = value;
+    }
+
+    void program_image::unmap() {
+        if (_mapping != nullptr) {
+            munmap(_mapping, _mapping_size);
+            _mapping = nullptr;
+            _mapping_size = 0;
+        }
+    }
+
+    bool program_image::capture(
+            common::result& r,
+            vm::terp& terp,
+            vm::ffi& ffi,
+            vm::assembler& assembler) {
+        auto heap_address = reinterpret_cast<uint64_t>(terp.heap());
+        auto program_start = terp.heap_vector(heap_vectors_t::program_start);
+        auto free_space_start = terp.heap_vector(heap_vectors_t::free_space_start);
+
+        _big_endian = terp.big_endian();
+        _heap_size = terp.heap_size();
+        _stack_size = terp.stack_size();
+        _heap_address = heap_address;
+        _program_start = program_start - heap_address;
+        _free_space_start = free_space_start - heap_address;
+
+        _program_bytes.assign(
+            terp.heap() + _program_start,
+            terp.heap() + _free_space_start);
+        _program = _program_bytes.data();
+        _program_size = _program_bytes.size();
+
+        _relocations = assembler.relocations();
+
+        _imports.clear();
+        for (const auto& relocation : _relocations) {
+            if (relocation.type != relocation_type_t::foreign_function)
+                continue;
+
+            instruction_t inst;
+            if (inst.decode(r, relocation.address) == 0)
+                return false;
+
+            auto address = inst.operands[relocation.operand].value.u;
+            auto it = std::find_if(
+                _imports.begin(),
+                _imports.end(),
+                [&](const program_image_import_t& import) {
+                    return import.address == address;
+                });
+            if (it != _imports.end())
+                continue;
+
+            auto signature = ffi.find_function(address);
+            if (signature == nullptr || signature->library == nullptr) {
+                r.error(
+                    "B070",
+                    fmt::format("unable to find foreign function by address: ${:016X}", address));
+                return false;
+            }
+
+            program_image_import_t import {};
+            import.address = address;
+            import.signature = *signature;
+            import.signature.func_ptr = nullptr;
+            import.signature.library = nullptr;
+            import.library = signature->library->path().string();
+            import.self_loaded = signature->library->self_loaded();
+            _imports.push_back(import);
+        }
+
+        _listing.clear();
+        auto& listing = assembler.listing();
+        for (const auto& name : listing.file_names())
+            _listing.push_back(*listing.source_file(name));
+
+        return !r.is_failed();
+    }
+
+    bool program_image::load(
+            common::result& r,
+            vm::terp& terp,
+            vm::ffi& ffi,
+            vm::assembler& assembler) {
+        if (_big_endian != terp.big_endian()) {
+            r.error(
+                "B071",
+                fmt::format(
+                    "program image was assembled for a {} endian terp.",
+                    _big_endian ? "big" : "little"));
+            return false;
+        }
+
+        if (_program_start != terp::program_start
+        ||  _free_space_start < _program_start
+        ||  _free_space_start - _program_start != _program_size
+        ||  _free_space_start > terp.heap_size() - terp.stack_size()) {
+            r.error(
+                "B071",
+                fmt::format(
+                    "program image does not fit the terp heap: program size = {}, heap size = {}.",
+                    _program_size,
+                    terp.heap_size()));
+            return false;
+        }
+
+        std::unordered_map<uint64_t, uint64_t> foreign_functions {};
+        if (!resolve_imports(r, ffi, foreign_functions))
+            return false;
+
+        memcpy(terp.heap() + _program_start, _program, _program_size);
+
+        if (!relocate(r, terp, foreign_functions))
+            return false;
+
+        auto heap_address = reinterpret_cast<uint64_t>(terp.heap());
+        terp.heap_free_space_begin(heap_address + _free_space_start);
+
+        auto delta = heap_address - _heap_address;
+        auto& listing = assembler.listing();
+        listing.reset();
+        for (const auto& file : _listing) {
+            listing.add_source_file(file.path.string());
+            auto source_file = listing.source_file(file.path.string());
+            source_file->lines = file.lines;
+            for (auto& line : source_file->lines) {
+                if (line.address != 0)
+                    line.address += delta;
+            }
+        }
+
+        return !r.is_failed();
+    }
+
+    bool program_image::resolve_imports(
+            common::result& r,
+            vm::ffi& ffi,
+            std::unordered_map<uint64_t, uint64_t>& foreign_functions) {
+        for (const auto& import : _imports) {
+            auto library = ffi.load_shared_library(r, import.library);
+            if (library == nullptr)
+                return false;
+            library->self_loaded(import.self_loaded);
+
+            auto signature = import.signature;
+            signature.library = library;
+            signature.call_site_arguments.clear();
+            if (!ffi.register_function(r, signature)) {
+                r.error(
+                    "B072",
+                    fmt::format(
+                        "unable to find foreign function symbol: {}",
+                        import.signature.symbol));
+                return false;
+            }
+
+            auto address = reinterpret_cast<uint64_t>(signature.func_ptr);
+            auto registered = ffi.find_function(address);
+            for (const auto& kvp : import.signature.call_site_arguments)
+                ffi.register_call_site(registered, kvp.first, kvp.second);
+
+            foreign_functions.insert(std::make_pair(import.address, address));
+        }
+        return true;
+    }
+
+    bool program_image::relocate(
+            common::result& r,
+            vm::terp& terp,
+            const std::unordered_map<uint64_t, uint64_t>& foreign_functions) {
+        auto delta = reinterpret_cast<uint64_t>(terp.heap()) - _heap_address;
+        auto program_start = _heap_address + _program_start;
+        auto program_end = _heap_address + _free_space_start;
+
+        for (const auto& relocation : _relocations) {
+            if (relocation.address < program_start
+            ||  relocation.address >= program_end) {
+                r.error(
+                    "B073",
+                    fmt::format(
+                        "relocation outside of the program region: ${:016X}",
+                        relocation.address));
+                return false;
+            }
+
+            auto address = relocation.address + delta;
+
+            if (relocation.size != op_sizes::none) {
+                terp.write(
+                    relocation.size,
+                    address,
+                    terp.read(relocation.size, address) + delta);
+                continue;
+            }
+
+            instruction_t inst;
+            if (inst.decode(r, address) == 0)
+                return false;
+
+            if (relocation.operand >= inst.operands_count
+            ||  inst.operands[relocation.operand].is_reg()
+            ||  inst.operands[relocation.operand].size != op_sizes::qword) {
+                r.error(
+                    "B073",
+                    fmt::format(
+                        "relocation does not name a qword constant: ${:016X}",
+                        relocation.address));
+                return false;
+            }
+
+            auto& operand = inst.operands[relocation.operand];
+            switch (relocation.type) {
+                case relocation_type_t::heap_address: {
+                    operand.value.u += delta;
+                    break;
+                }
+                case relocation_type_t::foreign_function: {
+                    auto it = foreign_functions.find(operand.value.u);
+                    if (it == foreign_functions.end()) {
+                        r.error(
+                            "B070",
+                            fmt::format(
+                                "unable to find foreign function by address: ${:016X}",
+                                operand.value.u));
+                        return false;
+                    }
+                    operand.value.u = it->second;
+                    break;
+                }
+            }
+
+            if (inst.encode(r, address) == 0)
+                return false;
+        }
+
+        return true;
+    }
+
+    bool program_image::read(
+            common::result& r,
+            const boost::filesystem::path& path) {
+        unmap();
+
+        auto fd = open(path.string().c_str(), O_RDONLY);
+        if (fd == -1) {
+            r.error(
+                "B074",
+                fmt::format("unable to open program image: {}", path.string()));
+            return false;
+        }
+
+        struct stat info {};
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            _mapping_size = static_cast<size_t>(info.st_size);
+            _mapping = mmap(nullptr, _mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (_mapping == MAP_FAILED) {
+                _mapping = nullptr;
+                _mapping_size = 0;
+            }
+        }
+        close(fd);
+
+        if (_mapping == nullptr) {
+            r.error(
+                "B074",
+                fmt::format("unable to map program image: {}", path.string()));
+            return false;
+        }
+
+        auto data = reinterpret_cast<const uint8_t*>(_mapping);
+        image_reader reader(data, _mapping_size);
+
+        if (reader.u32() != magic || reader.u16() != version) {
+            r.error(
+                "B075",
+                fmt::format("not a program image, or an image of another version: {}", path.string()));
+            return false;
+        }
+
+        auto flags = reader.u16();
+        _run = (flags & run_flag) != 0;
+        _big_endian = (flags & big_endian_flag) != 0;
+        _heap_address = reader.u64();
+        _heap_size = reader.u64();
+        _stack_size = reader.u64();
+        _program_start = reader.u64();
+        _free_space_start = reader.u64();
+        auto program_offset = reader.u64();
+        _program_size = reader.u64();
+
+        _relocations.clear();
+        auto relocation_count = reader.u32();
+        for (uint32_t i = 0; i < relocation_count && !reader.failed(); i++) {
+            relocation_t relocation {};
+            relocation.type = static_cast<relocation_type_t>(reader.u8());
+            relocation.operand = reader.u8();
+            relocation.size = static_cast<op_sizes>(reader.u8());
+            relocation.address = reader.u64();
+            _relocations.push_back(relocation);
+        }
+
+        _imports.clear();
+        auto import_count = reader.u32();
+        for (uint32_t i = 0; i < import_count && !reader.failed(); i++) {
+            program_image_import_t import {};
+            import.address = reader.u64();
+            import.self_loaded = reader.u8() != 0;
+            import.library = reader.string();
+            import.signature.symbol = reader.string();
+            import.signature.calling_mode = static_cast<ffi_calling_mode_t>(reader.u8());
+            import.signature.return_value = reader.function_value();
+            import.signature.arguments = reader.function_values();
+            auto call_site_count = reader.u32();
+            for (uint32_t j = 0; j < call_site_count && !reader.failed(); j++) {
+                auto id = static_cast<common::id_t>(reader.u64());
+                import.signature.call_site_arguments.insert(std::make_pair(
+                    id,
+                    reader.function_values()));
+            }
+            _imports.push_back(import);
+        }
+
+        _interned_strings.clear();
+        auto string_count = reader.u32();
+        for (uint32_t i = 0; i < string_count && !reader.failed(); i++) {
+            auto id = static_cast<common::id_t>(reader.u64());
+            _interned_strings.insert(std::make_pair(id, reader.string()));
+        }
+
+        _listing.clear();
+        auto file_count = reader.u32();
+        for (uint32_t i = 0; i < file_count && !reader.failed(); i++) {
+            listing_source_file_t file {};
+            file.path = reader.string();
+            auto line_count = reader.u32();
+            for (uint32_t j = 0; j < line_count && !reader.failed(); j++) {
+                listing_source_line_t line {};
+                line.address = reader.u64();
+                line.type = static_cast<listing_source_line_type_t>(reader.u8());
+                line.source = reader.string();
+                file.lines.push_back(line);
+            }
+            _listing.push_back(file);
+        }
+
+        if (reader.failed()
+        ||  program_offset > _mapping_size
+        ||  _program_size > _mapping_size - program_offset) {
+            r.error(
+                "B075",
+                fmt::format("program image is truncated: {}", path.string()));
+            return false;
+        }
+
+        _program_bytes.clear();
+        _program = data + program_offset;
+
+        return true;
+    }
+
+    bool program_image::write(
+            common::result& r,
+            const boost::filesystem::path& path) const {
+        uint16_t flags = 0;
+        if (_run)
+            flags |= run_flag;
+        if (_big_endian)
+            flags |= big_endian_flag;
+
+        image_writer writer {};
+        writer.u32(magic);
+        writer.u16(version);
+        writer.u16(flags);
+        writer.u64(_heap_address);
+        writer.u64(_heap_size);
+        writer.u64(_stack_size);
+        writer.u64(_program_start);
+        writer.u64(_free_space_start);
+
+        // patched once the tables are written
+        auto program_offset_at = writer.offset();
+        writer.u64(0);
+        writer.u64(_program_size);
+
+        writer.u32(static_cast<uint32_t>(_relocations.size()));
+        for (const auto& relocation : _relocations) {
+            writer.u8(static_cast<uint8_t>(relocation.type));
+            writer.u8(relocation.operand);
+            writer.u8(static_cast<uint8_t>(relocation.size));
+            writer.u64(relocation.address);
+        }
+
+        writer.u32(static_cast<uint32_t>(_imports.size()));
+        for (const auto& import : _imports) {
+            writer.u64(import.address);
+            writer.u8(static_cast<uint8_t>(import.self_loaded ? 1 : 0));
+            writer.string(import.library);
+            writer.string(import.signature.symbol);
+            writer.u8(static_cast<uint8_t>(import.signature.calling_mode));
+            writer.function_value(import.signature.return_value);
+            writer.function_values(import.signature.arguments);
+            writer.u32(static_cast<uint32_t>(import.signature.call_site_arguments.size()));
+            for (const auto& kvp : import.signature.call_site_arguments) {
+                writer.u64(kvp.first);
+                writer.function_values(kvp.second);
+            }
+        }
+
+        writer.u32(static_cast<uint32_t>(_interned_strings.size()));
+        for (const auto& kvp : _interned_strings) {
+            writer.u64(kvp.first);
+            writer.string(kvp.second);
+        }
+
+        writer.u32(static_cast<uint32_t>(_listing.size()));
+        for (const auto& file : _listing) {
+            writer.string(file.path.string());
+            writer.u32(static_cast<uint32_t>(file.lines.size()));
+            for (const auto& line : file.lines) {
+                writer.u64(line.address);
+                writer.u8(static_cast<uint8_t>(line.type));
+                writer.string(line.source);
+            }
+        }
+
+        writer.align(program_alignment);
+        writer.patch(program_offset_at, writer.offset());
+        writer.bytes(_program, _program_size);
+
+        const auto& buffer = writer.buffer();
+
+        auto file = fopen(path.string().c_str(), "wb");
+        if (file == nullptr) {
+            r.error(
+                "B074",
+                fmt::format("unable to create program image: {}", path.string()));
+            return false;
+        }
+
+        auto written = fwrite(buffer.data(), 1, buffer.size(), file);
+        auto closed = fclose(file) == 0;
+        if (written != buffer.size() || !closed) {
+            r.error(
+                "B074",
+                fmt::format("unable to write program image: {}", path.string()));
+            return false;
+        }
+
+        return true;
+    }
+
+    void program_image::add_interned_string(
+            common::id_t id,
+            const std::string& value) {
+        _interned_strings.insert(std::make_pair(id, value));
+    }
+
+    const std::map<common::id_t, std::string>& program_image::interned_strings() const {
+        return _interned_strings;
+    }
+
+};
@@ -0,0 +1,117 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <map>
+#include <boost/filesystem.hpp>
+#include "vm_types.h"
+
+namespace basecode::vm {
+
+    class ffi;
+    class assembler;
+
+    // a foreign function the program calls.  the signature is kept without
+    // its library and function pointer; both are resolved again by path and
+    // symbol when the image is loaded.  address is the function's address
+    // in the process that wrote the image.
+    struct program_image_import_t {
+        uint64_t address = 0;
+        bool self_loaded = false;
+        std::string library {};
+        function_signature_t signature {};
+    };
+
+    using program_image_import_list_t = std::vector<program_image_import_t>;
+
+    // the program region of an assembled terp: the encoded bytes from
+    // program_start to free_space_start, every absolute address encoded
+    // into them, the ffi imports, the interned string table and the
+    // assembly listing.  load copies the bytes into another terp's heap and
+    // rebases the addresses, so a program only has to be compiled once.
+    //
+    // the file is written in host byte order: a header, the tables and then
+    // the program bytes.  read maps the file and copies the bytes straight
+    // out of the mapping.
+    class program_image {
+    public:
+        static constexpr uint32_t magic = 0x4d494342;
+        static constexpr uint16_t version = 1;
+        static constexpr size_t program_alignment = 16;
+
+        program_image() = default;
+
+        ~program_image();
+
+        bool run() const;
+
+        void run(bool value);
+
+        bool capture(
+            common::result& r,
+            vm::terp& terp,
+            vm::ffi& ffi,
+            vm::assembler& assembler);
+
+        bool load(
+            common::result& r,
+            vm::terp& terp,
+            vm::ffi& ffi,
+            vm::assembler& assembler);
+
+        bool read(
+            common::result& r,
+            const boost::filesystem::path& path);
+
+        bool write(
+            common::result& r,
+            const boost::filesystem::path& path) const;
+
+        void add_interned_string(
+            common::id_t id,
+            const std::string& value);
+
+        const std::map<common::id_t, std::string>& interned_strings() const;
+
+    private:
+        void unmap();
+
+        bool relocate(
+            common::result& r,
+            vm::terp& terp,
+            const std::unordered_map<uint64_t, uint64_t>& foreign_functions);
+
+        bool resolve_imports(
+            common::result& r,
+            vm::ffi& ffi,
+            std::unordered_map<uint64_t, uint64_t>& foreign_functions);
+
+    private:
+        bool _run = false;
+        bool _big_endian = false;
+        size_t _heap_size = 0;
+        size_t _stack_size = 0;
+        void* _mapping = nullptr;
+        size_t _mapping_size = 0;
+        size_t _program_size = 0;
+        uint64_t _heap_address = 0;
+        uint64_t _program_start = 0;
+        uint64_t _free_space_start = 0;
+        const uint8_t* _program = nullptr;
+        relocation_list_t _relocations {};
+        std::vector<uint8_t> _program_bytes {};
+        program_image_import_list_t _imports {};
+        std::vector<listing_source_file_t> _listing {};
+        std::map<common::id_t, std::string> _interned_strings {};
+    };
+
+};
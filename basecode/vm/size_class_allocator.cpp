@@ -0,0 +1,194 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#include <common/bytes.h>
+#include "size_class_allocator.h"
+
+namespace basecode::vm {
+
+    static inline uint64_t next_free_block(uint64_t address) {
+        return *reinterpret_cast<uint64_t*>(address);
+    }
+
+    static inline void next_free_block(uint64_t address, uint64_t next) {
+        *reinterpret_cast<uint64_t*>(address) = next;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    void size_class_allocator::reset() {
+        _top = _start;
+        _large_free_list = 0;
+        for (auto& free_list : _free_lists)
+            free_list = 0;
+    }
+
+    void size_class_allocator::save(allocator_state_t& state) const {
+        state = {_end, _top, _size, _start, _address, _large_free_list};
+        state.insert(state.end(), std::begin(_free_lists), std::end(_free_lists));
+    }
+
+    void size_class_allocator::restore(const allocator_state_t& state) {
+        _end = state[0];
+        _top = state[1];
+        _size = state[2];
+        _start = state[3];
+        _address = state[4];
+        _large_free_list = state[5];
+        for (size_t i = 0; i < number_of_size_classes; i++)
+            _free_lists[i] = state[6 + i];
+    }
+
+    void size_class_allocator::initialize(
+            uint64_t address,
+            uint64_t size) {
+        _size = size;
+        _address = address;
+        _start = common::align(address, alignment);
+        _end = _start < address + size ? address + size : _start;
+        reset();
+    }
+
+    size_t size_class_allocator::size_class_for(uint64_t size) {
+        size_t size_class = 0;
+        auto class_size = minimum_small_size;
+        while (class_size < size && size_class < number_of_size_classes) {
+            class_size <<= 1;
+            size_class++;
+        }
+        return size_class;
+    }
+
+    size_class_block_header_t* size_class_allocator::header(uint64_t address) const {
+        if (address < _start + header_size
+        ||  address >= _top
+        ||  (address - _start) % alignment != 0) {
+            return nullptr;
+        }
+
+        auto block_header = reinterpret_cast<size_class_block_header_t*>(address - header_size);
+        if (block_header->tag != allocated_tag && block_header->tag != free_tag)
+            return nullptr;
+        return block_header;
+    }
+
+    uint64_t size_class_allocator::carve(
+            uint64_t capacity,
+            uint32_t size_class) {
+        if (_end - _top < header_size + capacity)
+            return 0;
+
+        auto block_header = reinterpret_cast<size_class_block_header_t*>(_top);
+        block_header->capacity = capacity;
+        block_header->size_class = size_class;
+        block_header->tag = allocated_tag;
+
+        auto address = _top + header_size;
+        _top = address + capacity;
+        return address;
+    }
+
+    uint64_t size_class_allocator::alloc(uint64_t size) {
+        auto size_class = size_class_for(size);
+        if (size_class < number_of_size_classes) {
+            auto& free_list = _free_lists[size_class];
+            if (free_list != 0) {
+                auto address = free_list;
+                free_list = next_free_block(address);
+                header(address)->tag = allocated_tag;
+                return address;
+            }
+
+            auto address = carve(
+                minimum_small_size << size_class,
+                static_cast<uint32_t>(size_class));
+            if (address != 0)
+                return address;
+        }
+
+        return alloc_large(size);
+    }
+
+    uint64_t size_class_allocator::alloc_large(uint64_t size) {
+        if (size > _end - _start)
+            return 0;
+
+        auto capacity = common::align(size == 0 ? 1 : size, alignment);
+
+        uint64_t prev = 0;
+        auto address = _large_free_list;
+        while (address != 0) {
+            auto block_header = header(address);
+            if (block_header == nullptr)
+                break;
+
+            if (block_header->capacity >= capacity) {
+                auto next = next_free_block(address);
+
+                // if the remainder can hold a small block, split it off
+                auto remainder = block_header->capacity - capacity;
+                if (remainder >= header_size + maximum_small_size) {
+                    auto split_address = address + capacity + header_size;
+                    auto split_header = reinterpret_cast<size_class_block_header_t*>(
+                        split_address - header_size);
+                    split_header->capacity = remainder - header_size;
+                    split_header->size_class = large_size_class;
+                    split_header->tag = free_tag;
+                    next_free_block(split_address, next);
+                    next = split_address;
+                    block_header->capacity = capacity;
+                }
+
+                if (prev == 0)
+                    _large_free_list = next;
+                else
+                    next_free_block(prev, next);
+
+                block_header->tag = allocated_tag;
+                return address;
+            }
+            prev = address;
+            address = next_free_block(address);
+        }
+
+        return carve(capacity, large_size_class);
+    }
+
+    uint64_t size_class_allocator::free(uint64_t address) {
+        auto block_header = header(address);
+        if (block_header == nullptr || block_header->tag != allocated_tag)
+            return 0;
+
+        auto freed_size = block_header->capacity;
+        block_header->tag = free_tag;
+
+        if (block_header->size_class < number_of_size_classes) {
+            auto& free_list = _free_lists[block_header->size_class];
+            next_free_block(address, free_list);
+            free_list = address;
+        } else if (address + freed_size == _top) {
+            _top = address - header_size;
+        } else {
+            next_free_block(address, _large_free_list);
+            _large_free_list = address;
+        }
+
+        return freed_size;
+    }
+
+    uint64_t size_class_allocator::size(uint64_t address) {
+        auto block_header = header(address);
+        if (block_header == nullptr || block_header->tag != allocated_tag)
+            return 0;
+        return block_header->capacity;
+    }
+
+};
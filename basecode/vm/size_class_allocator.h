@@ -0,0 +1,86 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include "vm_types.h"
+
+namespace basecode::vm {
+
+    // every block is preceded by this header inside the vm heap
+    struct size_class_block_header_t {
+        uint64_t capacity = 0;
+        uint32_t size_class = 0;
+        uint32_t tag = 0;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    // blocks of up to maximum_small_size bytes are rounded up to a power of
+    // two size class and recycled through a free list per class.  larger
+    // blocks are taken first-fit from a list of freed large blocks and split
+    // when the remainder is big enough.  both paths carve new blocks from the
+    // top of the heap; freeing the block below the top gives the space back.
+    // free lists are linked through the first qword of each freed block.
+    class size_class_allocator : public allocator {
+    public:
+        static constexpr uint64_t alignment = 16;
+        static constexpr uint64_t minimum_small_size = 16;
+        static constexpr size_t number_of_size_classes = 8;
+        static constexpr uint64_t maximum_small_size =
+            minimum_small_size << (number_of_size_classes - 1);
+        static constexpr uint64_t header_size = sizeof(size_class_block_header_t);
+        static constexpr uint32_t large_size_class = 0xffffffff;
+        static constexpr uint32_t free_tag = 0xf4eeb10c;
+        static constexpr uint32_t allocated_tag = 0xa110ca7e;
+
+        size_class_allocator() = default;
+
+        ~size_class_allocator() override = default;
+
+        void reset() override;
+
+        void save(allocator_state_t& state) const override;
+
+        void restore(const allocator_state_t& state) override;
+
+        void initialize(
+            uint64_t address,
+            uint64_t size) override;
+
+        uint64_t alloc(uint64_t size) override;
+
+        uint64_t size(uint64_t address) override;
+
+        uint64_t free(uint64_t address) override;
+
+    private:
+        uint64_t carve(
+            uint64_t capacity,
+            uint32_t size_class);
+
+        uint64_t alloc_large(uint64_t size);
+
+        static size_t size_class_for(uint64_t size);
+
+        size_class_block_header_t* header(uint64_t address) const;
+
+    private:
+        uint64_t _end = 0;
+        uint64_t _top = 0;
+        uint64_t _size = 0;
+        uint64_t _start = 0;
+        uint64_t _address = 0;
+        uint64_t _large_free_list = 0;
+        uint64_t _free_lists[number_of_size_classes] {};
+    };
+
+};
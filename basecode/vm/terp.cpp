@@ -9,14 +9,22 @@
 //
 // ----------------------------------------------------------------------------
 
+#include <limits>
 #include <sstream>
 #include <climits>
 #include <iomanip>
+#include <unistd.h>
+#include <algorithm>
+#include <sys/mman.h>
 #include <fmt/format.h>
 #include <common/bytes.h>
 #include <common/hex_formatter.h>
+#include <common/string_support.h>
 #include "ffi.h"
 #include "terp.h"
+#include "profiler.h"
+#include "heap_snapshot.h"
+#include "memory_kernels.h"
 #include "instruction_block.h"
 
 namespace basecode::vm {
@@ -310,6 +318,8 @@ namespace basecode::vm {
             }
 
             stream << std::left << std::setw(10) << mnemonic.str();
+            if (mnemonic.str().length() >= 10)
+                stream << " ";
 
             std::stringstream operands_stream;
             for (size_t i = 0; i < operands_count; i++) {
@@ -331,6 +341,8 @@ namespace basecode::vm {
                         } else {
                             operands_stream << fmt::format("F{}-F{}", start, end);
                         }
+                    } else if (operand.is_vector()) {
+                        operands_stream << "V" << std::to_string(operand.value.r);
                     } else {
                         if (operand.is_integer()) {
                             switch (operand.value.r) {
@@ -407,30 +419,240 @@ namespace basecode::vm {
     }
 
     void instruction_cache::reset() {
-        _cache.clear();
+        for (auto& entry : _entries)
+            entry.size = 0;
+        std::fill(_code_slots.begin(), _code_slots.end(), 0);
     }
 
     size_t instruction_cache::fetch_at(
             common::result& r,
             uint64_t address,
             instruction_t& inst) {
-        auto it = _cache.find(address);
-        if (it == _cache.end()) {
-            auto size = inst.decode(r, address);
-            if (size == 0)
-                return 0;
-            _cache.insert(std::make_pair(
-                address,
-                icache_entry_t{.size = size, .inst = inst}));
-            return size;
+        auto entry = entry_at(r, address);
+        if (entry == nullptr)
+            return 0;
+        inst = entry->inst;
+        return entry->size;
+    }
+
+    bool instruction_cache::invalidate(uint64_t address, size_t size) {
+        if (size == 0 || address >= _end || address + size <= _start)
+            return false;
+
+        // most writes into the program region hit data, not decoded code
+        auto first_slot = address < _start ? 0 : (address - _start) / instruction_t::alignment;
+        auto last_slot = (std::min<uint64_t>(address + size, _end) - _start - 1)
+            / instruction_t::alignment;
+        auto is_code = false;
+        for (auto slot = first_slot; slot <= last_slot; slot++) {
+            if (_code_slots[slot]) {
+                is_code = true;
+                break;
+            }
+        }
+        if (!is_code)
+            return false;
+
+        // an instruction that starts before the range may still overlap it
+        auto first = _start;
+        if (address > _start) {
+            first += ((address - _start) / instruction_t::alignment)
+                * instruction_t::alignment;
+        }
+        auto slot_address = first - std::min<uint64_t>(
+            first - _start,
+            common::align(instruction_t::maximum_size, instruction_t::alignment));
+        auto last = std::min<uint64_t>(address + size, _end);
+        for (; slot_address < last; slot_address += instruction_t::alignment) {
+            auto& entry = _entries[(slot_address - _start) / instruction_t::alignment];
+            if (slot_address + entry.size > address)
+                entry.size = 0;
+        }
+
+        return true;
+    }
+
+    void instruction_cache::initialize(uint64_t start, uint64_t end) {
+        _start = start;
+        _end = end > start ? end : start;
+        _entries.clear();
+        _entries.resize((_end - _start) / instruction_t::alignment);
+        _code_slots.assign(_entries.size(), 0);
+        _end = _start + _entries.size() * instruction_t::alignment;
+    }
+
+    const icache_entry_t* instruction_cache::fetch(common::result& r) {
+        return entry_at(r, _terp->register_file().r[register_pc].qw);
+    }
+
+    const icache_entry_t* instruction_cache::entry_at(
+            common::result& r,
+            uint64_t address) {
+        auto offset = address - _start;
+        if (address < _start
+        ||  address >= _end
+        ||  (offset % instruction_t::alignment) != 0) {
+            _uncached.size = _uncached.inst.decode(r, address);
+            return _uncached.size == 0 ? nullptr : &_uncached;
+        }
+
+        auto index = offset / instruction_t::alignment;
+        auto& entry = _entries[index];
+        if (entry.size == 0) {
+            entry.size = entry.inst.decode(r, address);
+            if (entry.size == 0)
+                return nullptr;
+
+            auto last_index = std::min<size_t>(
+                index + common::align(entry.size, instruction_t::alignment) / instruction_t::alignment,
+                _code_slots.size());
+            for (auto i = index; i < last_index; i++)
+                _code_slots[i] = 1;
+        }
+        return &entry;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    void address_region_table::reset() {
+        _stamp = 0;
+        _last_hit = 0;
+        _regions.clear();
+    }
+
+    bool address_region_table::empty() const {
+        return _regions.empty();
+    }
+
+    bool address_region_table::contains(uint64_t address) {
+        if (_last_hit < _regions.size()) {
+            const auto& region = _regions[_last_hit];
+            if (address >= region.start && address < region.end)
+                return true;
+        }
+
+        auto it = std::upper_bound(
+            _regions.begin(),
+            _regions.end(),
+            address,
+            [](uint64_t value, const address_region_t& region) {
+                return value < region.start;
+            });
+        if (it == _regions.begin())
+            return false;
+
+        --it;
+        if (address >= it->end)
+            return false;
+
+        _last_hit = static_cast<size_t>(it - _regions.begin());
+        return true;
+    }
+
+    bool address_region_table::contains(uint64_t address, size_t size) {
+        if (!contains(address))
+            return false;
+
+        // regions never touch, so a valid range lies within a single region
+        const auto& region = _regions[_last_hit];
+        return size <= region.end - address;
+    }
+
+    void address_region_table::add(uint64_t address, size_t size) {
+        if (size == 0)
+            return;
+
+        auto start = address;
+        auto end = address + size < address ?
+            std::numeric_limits<uint64_t>::max() :
+            address + size;
+        auto find_first = [&]() {
+            return std::lower_bound(
+                _regions.begin(),
+                _regions.end(),
+                start,
+                [](const address_region_t& region, uint64_t value) {
+                    return region.end < value;
+                });
+        };
+
+        // overlapping and adjacent regions are merged into one
+        auto first = find_first();
+        auto last = first;
+        while (last != _regions.end() && last->start <= end) {
+            start = std::min(start, last->start);
+            end = std::max(end, last->end);
+            ++last;
+        }
+
+        if (first == last) {
+            if (_regions.size() >= maximum_regions) {
+                evict_oldest();
+                first = find_first();
+            }
+            _regions.insert(first, address_region_t {start, end, ++_stamp});
         } else {
-            inst = it->second.inst;
-            return it->second.size;
+            *first = address_region_t {start, end, ++_stamp};
+            _regions.erase(first + 1, last);
+        }
+
+        _last_hit = 0;
+    }
+
+    void address_region_table::evict_oldest() {
+        auto oldest = std::min_element(
+            _regions.begin(),
+            _regions.end(),
+            [](const address_region_t& lhs, const address_region_t& rhs) {
+                return lhs.stamp < rhs.stamp;
+            });
+        if (oldest != _regions.end())
+            _regions.erase(oldest);
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    void trace_ring::reset() {
+        _head = 0;
+    }
+
+    size_t trace_ring::size() const {
+        return static_cast<size_t>(std::min<uint64_t>(_head, capacity));
+    }
+
+    uint64_t trace_ring::total() const {
+        return _head;
+    }
+
+    const trace_entry_t& trace_ring::operator[](size_t index) const {
+        return _entries[(_head - 1 - index) & (capacity - 1)];
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    template <typename T>
+    static T vector_arithmetic(
+            op_codes op,
+            const T& lhs,
+            const T& rhs) {
+        switch (op) {
+            case op_codes::vadd:
+            case op_codes::vfadd:
+                return lhs + rhs;
+            case op_codes::vsub:
+            case op_codes::vfsub:
+                return lhs - rhs;
+            default:
+                return lhs * rhs;
         }
     }
 
-    size_t instruction_cache::fetch(common::result& r, instruction_t& inst) {
-        return fetch_at(r, _terp->register_file().r[register_pc].qw, inst);
+    template <typename R, typename T>
+    static R vector_sum(const T& value) {
+        R sum = 0;
+        for (size_t i = 0; i < sizeof(T) / sizeof(value[0]); i++)
+            sum += value[i];
+        return sum;
     }
 
     ///////////////////////////////////////////////////////////////////////////
@@ -439,21 +661,25 @@ namespace basecode::vm {
         vm::ffi* ffi,
         vm::allocator* allocator,
         size_t heap_size,
-        size_t stack_size) : _ffi(ffi),
-                             _heap_size(heap_size),
-                             _stack_size(stack_size),
-                             _icache(this),
-                             _allocator(allocator) {
+        size_t stack_size,
+        execution_engine_t engine) : _ffi(ffi),
+                                     _heap_size(heap_size),
+                                     _stack_size(stack_size),
+                                     _icache(this),
+                                     _engine(engine),
+                                     _threaded_engine(this),
+                                     _allocator(allocator) {
     }
 
     terp::~terp() {
-        delete _heap;
+        if (_heap != nullptr && !_shared_heap)
+            munmap(_heap, _heap_mapping_size);
         _heap = nullptr;
     }
 
     void terp::reset() {
         _registers.r[register_pc].qw = heap_vector(heap_vectors_t::program_start);
-        _registers.r[register_sp].qw = heap_vector(heap_vectors_t::top_of_stack);
+        _registers.r[register_sp].qw = _stack_top;
         _registers.r[register_fp].qw = 0;
         _registers.r[register_fr].qw = 0;
         _registers.r[register_sr].qw = 0;
@@ -461,21 +687,32 @@ namespace basecode::vm {
         for (size_t i = 0; i < number_general_purpose_registers; i++) {
             _registers.r[i].qw = 0;
         }
+        _vector_registers = {};
 
+        _trace.reset();
         _icache.reset();
+        _threaded_engine.reset();
+        _address_regions.reset();
         _allocator->reset();
 
         _exited = false;
+        _current_fiber = 0;
     }
 
+    // the stack never overlaps the program region, so push, pop and peek
+    // use word-sized accesses and skip code invalidation
     uint64_t terp::pop() {
-        uint64_t value = read(op_sizes::qword, _registers.r[register_sp].qw);
-        _registers.r[register_sp].qw += sizeof(uint64_t);
-        return value;
+        uint64_t value = 0;
+        auto& sp = _registers.r[register_sp].qw;
+        memcpy(&value, reinterpret_cast<void*>(sp), sizeof(uint64_t));
+        sp += sizeof(uint64_t);
+        return _swap_bytes ? common::endian_swap_qword(value) : value;
     }
 
     uint64_t terp::peek() const {
-        return read(op_sizes::qword, _registers.r[register_sp].qw);
+        uint64_t value = 0;
+        memcpy(&value, reinterpret_cast<void*>(_registers.r[register_sp].qw), sizeof(uint64_t));
+        return _swap_bytes ? common::endian_swap_qword(value) : value;
     }
 
     void terp::initialize_allocator() {
@@ -531,20 +768,69 @@ namespace basecode::vm {
     }
 
     bool terp::run(common::result& r) {
+        if (_profiler != nullptr)
+            return run_profiled(r);
+
+        if (_engine == execution_engine_t::threaded)
+            return _threaded_engine.run(r);
+
         while (!has_exited())
             if (!step(r))
                 return false;
         return true;
     }
 
+    // the same as step, with the profiler told about each instruction
+    // before it executes and about each jsr target after
+    bool terp::run_profiled(common::result& r) {
+        while (!has_exited()) {
+            auto entry = _icache.fetch(r);
+            if (entry == nullptr)
+                return false;
+
+            auto op = entry->inst.op;
+            auto address = _registers.r[register_pc].qw;
+            if (_profiler->record(address, op))
+                _profiler->sample(*this);
+
+            auto next = address + entry->size;
+            _registers.r[register_pc].qw = next;
+
+            if (!execute(r, entry->inst, entry->size))
+                return false;
+
+            auto pc = _registers.r[register_pc].qw;
+            if (pc != next)
+                _trace.record(address, pc);
+
+            if (op == op_codes::jsr)
+                _profiler->enter(pc);
+        }
+        return true;
+    }
+
     bool terp::step(common::result& r) {
-        instruction_t inst;
-        auto inst_size = _icache.fetch(r, inst);
-        if (inst_size == 0)
+        auto entry = _icache.fetch(r);
+        if (entry == nullptr)
+            return false;
+
+        auto address = _registers.r[register_pc].qw;
+        auto next = address + entry->size;
+        _registers.r[register_pc].qw = next;
+
+        if (!execute(r, entry->inst, entry->size))
             return false;
 
-        _registers.r[register_pc].qw += inst_size;
+        if (_registers.r[register_pc].qw != next)
+            _trace.record(address, _registers.r[register_pc].qw);
+
+        return true;
+    }
 
+    bool terp::execute(
+            common::result& r,
+            const instruction_t& inst,
+            uint64_t inst_size) {
         switch (inst.op) {
             case op_codes::nop: {
                 break;
@@ -658,23 +944,25 @@ namespace basecode::vm {
                 if (!get_operand_value(r, inst, 0, target_address))
                     return false;
 
-                if (!bounds_check_address(r, target_address))
+                if (!get_operand_value(r, inst, 1, source_address))
                     return false;
 
-                if (!get_operand_value(r, inst, 1, source_address))
+                operand_value_t length;
+                if (!get_operand_value(r, inst, 2, length))
                     return false;
+                length.alias.u *= op_size_in_bytes(inst.size);
 
-                if (!bounds_check_address(r, source_address))
+                if (!bounds_check_range(r, target_address.alias.u, length.alias.u))
                     return false;
 
-                operand_value_t length;
-                if (!get_operand_value(r, inst, 2, length))
+                if (!bounds_check_range(r, source_address.alias.u, length.alias.u))
                     return false;
 
-                memcpy(
+                copy_memory(
                     reinterpret_cast<void*>(target_address.alias.u),
                     reinterpret_cast<void*>(source_address.alias.u),
-                    length.alias.u * op_size_in_bytes(inst.size));
+                    length.alias.u);
+                invalidate_code(target_address.alias.u, length.alias.u);
 
                 _registers.flags(register_file_t::flags_t::zero, false);
                 _registers.flags(register_file_t::flags_t::carry, false);
@@ -770,9 +1058,6 @@ namespace basecode::vm {
                 if (!get_operand_value(r, inst, 0, address))
                     return false;
 
-                if (!bounds_check_address(r, address))
-                    return false;
-
                 operand_value_t value;
                 if (!get_operand_value(r, inst, 1, value))
                     return false;
@@ -780,33 +1065,42 @@ namespace basecode::vm {
                 operand_value_t length;
                 if (!get_operand_value(r, inst, 2, length))
                     return false;
-                length.alias.u *= op_size_in_bytes(inst.size);
 
-                switch (inst.size) {
-                    case op_sizes::byte:
-                        memset(
-                            reinterpret_cast<void*>(address.alias.u),
-                            static_cast<uint8_t>(value.alias.u),
-                            length.alias.u);
-                        break;
-                    case op_sizes::word:
-                        memset(
-                            reinterpret_cast<void*>(address.alias.u),
-                            static_cast<uint16_t>(value.alias.u),
-                            length.alias.u);
-                        break;
-                    case op_sizes::dword:
-                        memset(
-                            reinterpret_cast<void*>(address.alias.u),
-                            static_cast<uint32_t>(value.alias.u),
-                            length.alias.u);
-                        break;
-                    case op_sizes::qword:
-                    default:
-                        // XXX: this is an error
-                        break;
+                auto element_size = op_size_in_bytes(inst.size);
+                if (element_size == 0) {
+                    r.error(
+                        "B005",
+                        "fill cannot have a size of 'none'.");
+                    return false;
+                }
+
+                if (!bounds_check_range(r, address.alias.u, length.alias.u * element_size))
+                    return false;
+
+                if (_swap_bytes) {
+                    switch (inst.size) {
+                        case op_sizes::word:
+                            value.alias.u = common::endian_swap_word(static_cast<uint16_t>(value.alias.u));
+                            break;
+                        case op_sizes::dword:
+                            value.alias.u = common::endian_swap_dword(static_cast<uint32_t>(value.alias.u));
+                            break;
+                        case op_sizes::qword:
+                            value.alias.u = common::endian_swap_qword(value.alias.u);
+                            break;
+                        default:
+                            break;
+                    }
                 }
 
+                fill_pattern(
+                    reinterpret_cast<void*>(address.alias.u),
+                    value.alias.u,
+                    element_size,
+                    length.alias.u);
+                length.alias.u *= element_size;
+                invalidate_code(address.alias.u, length.alias.u);
+
                 _registers.flags(register_file_t::flags_t::zero, false);
                 _registers.flags(register_file_t::flags_t::carry, false);
                 _registers.flags(register_file_t::flags_t::overflow, false);
@@ -1091,10 +1385,6 @@ namespace basecode::vm {
                     }
                 }
 
-                if (_white_listed_addresses.count(reg_value.alias.u) > 0) {
-                    _white_listed_addresses.insert(new_value.alias.u);
-                }
-
                 if (set_target_operand_value(r, inst.operands[0], inst.size, new_value))
                     return false;
 
@@ -1158,10 +1448,6 @@ namespace basecode::vm {
                     }
                 }
 
-                if (_white_listed_addresses.count(reg_value.alias.u) > 0) {
-                    _white_listed_addresses.insert(new_value.alias.u);
-                }
-
                 if (set_target_operand_value(r, inst.operands[0], inst.size, new_value))
                     return false;
 
@@ -1228,11 +1514,6 @@ namespace basecode::vm {
                     }
                 }
 
-                if (_white_listed_addresses.count(lhs_value.alias.u) > 0
-                ||  _white_listed_addresses.count(rhs_value.alias.u) > 0) {
-                    _white_listed_addresses.insert(sum_result.alias.u);
-                }
-
                 if (!set_target_operand_value(r, inst.operands[0], inst.size, sum_result))
                     return false;
 
@@ -1308,11 +1589,6 @@ namespace basecode::vm {
                     }
                 }
 
-                if (_white_listed_addresses.count(lhs_value.alias.u) > 0
-                ||  _white_listed_addresses.count(rhs_value.alias.u) > 0) {
-                    _white_listed_addresses.insert(subtraction_result.alias.u);
-                }
-
                 if (!set_target_operand_value(r, inst.operands[0], inst.size, subtraction_result))
                     return false;
 
@@ -2809,6 +3085,8 @@ namespace basecode::vm {
             case op_codes::rts: {
                 auto address = pop();
                 _registers.r[register_pc].qw = address;
+                if (address == 0 && _current_fiber != 0)
+                    return finish_fiber(r);
                 break;
             }
             case op_codes::jmp: {
@@ -2905,52 +3183,249 @@ namespace basecode::vm {
                         return false;
                 }
 
-                auto func = _ffi->find_function(address.alias.u);
-                if (func == nullptr) {
+                auto plan = _ffi->find_call_plan(
+                    address.alias.u,
+                    static_cast<common::id_t>(signature_id.alias.u));
+                if (plan == nullptr) {
                     execute_trap(trap_invalid_ffi_call);
                     return false;
                 }
 
-                _ffi->reset();
-                _ffi->calling_convention(func->calling_mode);
+                call_foreign(*plan);
+                break;
+            }
+            case op_codes::meta: {
+                operand_value_t meta_data_size;
 
-                vm::function_value_list_t* arguments = nullptr;
-                if (func->is_variadic()) {
-                    auto it = func->call_site_arguments.find(
-                        static_cast<common::id_t>(signature_id.alias.u));
-                    if (it == func->call_site_arguments.end()) {
-                        execute_trap(trap_invalid_ffi_call);
-                        return false;
-                    }
-                    arguments = &it->second;
-                } else {
-                    arguments = &func->arguments;
-                }
+                if (!get_operand_value(r, inst, 0, meta_data_size))
+                    return false;
+
+                break;
+            }
+            case op_codes::exit: {
+                _exited = true;
+                break;
+            }
+            case op_codes::fiber: {
+                operand_value_t entry;
+                if (!get_operand_value(r, inst, 1, entry))
+                    return false;
+
+                operand_value_t stack_size;
+                if (!get_operand_value(r, inst, 2, stack_size))
+                    return false;
+
+                operand_value_t handle;
+                if (!create_fiber(r, entry.alias.u, stack_size.alias.u, handle.alias.u))
+                    return false;
+
+                if (!set_target_operand_value(r, inst.operands[0], op_sizes::qword, handle))
+                    return false;
+
+                _registers.flags(register_file_t::flags_t::carry, false);
+                _registers.flags(register_file_t::flags_t::subtract, false);
+                _registers.flags(register_file_t::flags_t::overflow, false);
+                _registers.flags(register_file_t::flags_t::negative, false);
+                _registers.flags(register_file_t::flags_t::zero, false);
+
+                break;
+            }
+            case op_codes::yield: {
+                operand_value_t value;
+                if (!get_operand_value(r, inst, 0, value))
+                    return false;
+
+                return yield_fiber(r, value.alias.u);
+            }
+            case op_codes::resume: {
+                operand_value_t handle;
+                if (!get_operand_value(r, inst, 1, handle))
+                    return false;
+
+                return resume_fiber(r, handle.alias.u, inst.operands[0], inst.size);
+            }
+            case op_codes::vload: {
+                vector_register_t* dest = nullptr;
+                if (!get_vector_register(r, inst, 0, dest))
+                    return false;
+
+                operand_value_t address;
+                if (!get_address_with_offset(r, inst, 1, 2, address))
+                    return false;
+
+                if (!bounds_check_range(r, address.alias.u, vector_register_size))
+                    return false;
+
+                memcpy(dest, reinterpret_cast<const void*>(address.alias.u), vector_register_size);
+                if (_swap_bytes)
+                    swap_vector_lanes(*dest, inst.size);
+                break;
+            }
+            case op_codes::vstore: {
+                vector_register_t* source = nullptr;
+                if (!get_vector_register(r, inst, 1, source))
+                    return false;
 
-                for (const auto& arg : *arguments) {
-                    auto value = pop();
-                    _ffi->push(arg, value);
+                operand_value_t address;
+                if (!get_address_with_offset(r, inst, 0, 2, address))
+                    return false;
+
+                if (!bounds_check_range(r, address.alias.u, vector_register_size))
+                    return false;
+
+                auto value = *source;
+                if (_swap_bytes)
+                    swap_vector_lanes(value, inst.size);
+                memcpy(reinterpret_cast<void*>(address.alias.u), &value, vector_register_size);
+                invalidate_code(address.alias.u, vector_register_size);
+                break;
+            }
+            case op_codes::vbroadcast: {
+                vector_register_t* dest = nullptr;
+                if (!get_vector_register(r, inst, 0, dest))
+                    return false;
+
+                operand_value_t value;
+                if (!get_operand_value(r, inst, 1, value))
+                    return false;
+
+                switch (inst.size) {
+                    case op_sizes::byte:
+                        dest->b = vector_u8_t {} + static_cast<uint8_t>(value.alias.u);
+                        break;
+                    case op_sizes::word:
+                        dest->w = vector_u16_t {} + static_cast<uint16_t>(value.alias.u);
+                        break;
+                    case op_sizes::dword:
+                        dest->dw = vector_u32_t {} + static_cast<uint32_t>(value.alias.u);
+                        break;
+                    case op_sizes::qword:
+                        dest->qw = vector_u64_t {} + value.alias.u;
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            }
+            case op_codes::vadd:
+            case op_codes::vsub:
+            case op_codes::vmul: {
+                vector_register_t* dest = nullptr;
+                vector_register_t* lhs = nullptr;
+                vector_register_t* rhs = nullptr;
+                if (!get_vector_register(r, inst, 0, dest)
+                ||  !get_vector_register(r, inst, 1, lhs)
+                ||  !get_vector_register(r, inst, 2, rhs)) {
+                    return false;
                 }
 
-                auto result_value = _ffi->call(func);
-                if (func->return_value.type != ffi_types_t::void_type) {
-                    push(result_value);
-                    if (func->return_value.type == ffi_types_t::pointer_type)
-                        _white_listed_addresses.insert(result_value);
+                switch (inst.size) {
+                    case op_sizes::byte:
+                        dest->b = vector_arithmetic(inst.op, lhs->b, rhs->b);
+                        break;
+                    case op_sizes::word:
+                        dest->w = vector_arithmetic(inst.op, lhs->w, rhs->w);
+                        break;
+                    case op_sizes::dword:
+                        dest->dw = vector_arithmetic(inst.op, lhs->dw, rhs->dw);
+                        break;
+                    case op_sizes::qword:
+                        dest->qw = vector_arithmetic(inst.op, lhs->qw, rhs->qw);
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            }
+            case op_codes::vfadd:
+            case op_codes::vfsub:
+            case op_codes::vfmul: {
+                vector_register_t* dest = nullptr;
+                vector_register_t* lhs = nullptr;
+                vector_register_t* rhs = nullptr;
+                if (!get_vector_register(r, inst, 0, dest)
+                ||  !get_vector_register(r, inst, 1, lhs)
+                ||  !get_vector_register(r, inst, 2, rhs)) {
+                    return false;
                 }
 
+                switch (inst.size) {
+                    case op_sizes::dword:
+                        dest->dwf = vector_arithmetic(inst.op, lhs->dwf, rhs->dwf);
+                        break;
+                    case op_sizes::qword:
+                        dest->qwf = vector_arithmetic(inst.op, lhs->qwf, rhs->qwf);
+                        break;
+                    default:
+                        r.error("B090", "float vector lanes must be dword or qword.");
+                        return false;
+                }
                 break;
             }
-            case op_codes::meta: {
-                operand_value_t meta_data_size;
+            case op_codes::vreduce: {
+                vector_register_t* source = nullptr;
+                if (!get_vector_register(r, inst, 1, source))
+                    return false;
 
-                if (!get_operand_value(r, inst, 0, meta_data_size))
+                operand_value_t sum;
+                switch (inst.size) {
+                    case op_sizes::byte:
+                        sum.alias.u = vector_sum<uint8_t>(source->b);
+                        break;
+                    case op_sizes::word:
+                        sum.alias.u = vector_sum<uint16_t>(source->w);
+                        break;
+                    case op_sizes::dword:
+                        sum.alias.u = vector_sum<uint32_t>(source->dw);
+                        break;
+                    case op_sizes::qword:
+                        sum.alias.u = vector_sum<uint64_t>(source->qw);
+                        break;
+                    default:
+                        break;
+                }
+
+                if (!set_target_operand_value(r, inst.operands[0], inst.size, sum))
                     return false;
 
+                _registers.flags(register_file_t::flags_t::carry, false);
+                _registers.flags(register_file_t::flags_t::subtract, false);
+                _registers.flags(register_file_t::flags_t::overflow, false);
+                _registers.flags(register_file_t::flags_t::zero, sum.alias.u == 0);
+                _registers.flags(
+                    register_file_t::flags_t::negative,
+                    is_negative(sum, inst.size));
                 break;
             }
-            case op_codes::exit: {
-                _exited = true;
+            case op_codes::vfreduce: {
+                vector_register_t* source = nullptr;
+                if (!get_vector_register(r, inst, 1, source))
+                    return false;
+
+                operand_value_t sum;
+                sum.type = register_type_t::floating_point;
+                switch (inst.size) {
+                    case op_sizes::dword:
+                        sum.alias.f = vector_sum<float>(source->dwf);
+                        break;
+                    case op_sizes::qword:
+                        sum.alias.d = vector_sum<double>(source->qwf);
+                        break;
+                    default:
+                        r.error("B090", "float vector lanes must be dword or qword.");
+                        return false;
+                }
+
+                if (!set_target_operand_value(r, inst.operands[0], inst.size, sum))
+                    return false;
+
+                _registers.flags(register_file_t::flags_t::carry, false);
+                _registers.flags(register_file_t::flags_t::subtract, false);
+                _registers.flags(register_file_t::flags_t::overflow, false);
+                _registers.flags(register_file_t::flags_t::zero, is_zero(inst.size, sum));
+                _registers.flags(
+                    register_file_t::flags_t::negative,
+                    is_negative(sum, inst.size));
                 break;
             }
         }
@@ -2958,6 +3433,19 @@ namespace basecode::vm {
         return !r.is_failed();
     }
 
+    void terp::call_foreign(const ffi_call_plan_t& plan) {
+        _ffi->begin_call(plan);
+        for (const auto& arg : plan.arguments)
+            _ffi->push(arg, pop());
+
+        auto result_value = _ffi->call(plan);
+        if (plan.return_type != ffi_types_t::void_type) {
+            push(result_value);
+            if (plan.return_type == ffi_types_t::pointer_type)
+                register_address_region(result_value, ffi_pointer_region_size);
+        }
+    }
+
     bool terp::has_exited() const {
         return _exited;
     }
@@ -2966,26 +3454,87 @@ namespace basecode::vm {
         return _heap_size;
     }
 
+    bool terp::big_endian() const {
+        return _big_endian;
+    }
+
+    void terp::big_endian(bool value) {
+        _big_endian = value;
+        _swap_bytes = _big_endian == common::is_platform_little_endian();
+        _threaded_engine.reset();
+    }
+
+    vm::profiler* terp::profiler() const {
+        return _profiler;
+    }
+
+    void terp::profiler(vm::profiler* value) {
+        _profiler = value;
+    }
+
+    bool terp::swap_bytes() const {
+        return _swap_bytes;
+    }
+
+    bool terp::jit() const {
+        return _threaded_engine.jit();
+    }
+
+    void terp::jit(bool value) {
+        _threaded_engine.jit(value);
+    }
+
+    bool terp::lazy_flags() const {
+        return _threaded_engine.lazy_flags();
+    }
+
+    void terp::lazy_flags(bool value) {
+        _threaded_engine.lazy_flags(value);
+    }
+
+    size_t terp::fused_count() const {
+        return _threaded_engine.fused_count();
+    }
+
+    size_t terp::native_block_count() const {
+        return _threaded_engine.native_block_count();
+    }
+
+    bool terp::superinstructions() const {
+        return _threaded_engine.superinstructions();
+    }
+
+    size_t terp::superinstruction_count() const {
+        return _threaded_engine.superinstruction_count();
+    }
+
+    void terp::superinstructions(bool value) {
+        _threaded_engine.superinstructions(value);
+    }
+
     size_t terp::stack_size() const {
         return _stack_size;
     }
 
     void terp::push(uint64_t value) {
-        _registers.r[register_sp].qw -= sizeof(uint64_t);
-        write(op_sizes::qword, _registers.r[register_sp].qw, value);
+        auto& sp = _registers.r[register_sp].qw;
+        sp -= sizeof(uint64_t);
+        if (_swap_bytes)
+            value = common::endian_swap_qword(value);
+        memcpy(reinterpret_cast<void*>(sp), &value, sizeof(uint64_t));
     }
 
     bool terp::bounds_check_address(
             common::result& r,
             const operand_value_t& address) {
-        if (_white_listed_addresses.count(address.alias.u))
-            return true;
-
         auto heap_bottom = _heap_address;
         auto heap_top = _heap_address + _heap_size;
 
         if (address.alias.u < heap_bottom
         ||  address.alias.u > heap_top) {
+            if (_address_regions.contains(address.alias.u))
+                return true;
+
             execute_trap(trap_invalid_address);
             r.error(
                 "B004",
@@ -3000,12 +3549,57 @@ namespace basecode::vm {
         return true;
     }
 
+    bool terp::bounds_check_range(
+            common::result& r,
+            uint64_t address,
+            uint64_t size) {
+        auto heap_bottom = _heap_address;
+        auto heap_top = _heap_address + _heap_size;
+
+        if (address >= heap_bottom
+        &&  address <= heap_top
+        &&  size <= heap_top - address) {
+            return true;
+        }
+
+        if (_address_regions.contains(address, size))
+            return true;
+
+        execute_trap(trap_invalid_address);
+        r.error(
+            "B004",
+            fmt::format(
+                "invalid address range: ${:016X}-${:016X}; bottom: ${:016X}; top: ${:016X}",
+                address,
+                address + size,
+                heap_bottom,
+                heap_top));
+        return false;
+    }
+
     bool terp::initialize(common::result& r) {
         if (_heap != nullptr)
             return true;
 
-        _heap = new uint8_t[_heap_size];
+        // the heap is its own page aligned mapping so a heap snapshot can
+        // be mapped over it
+        auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        _heap_mapping_size = (_heap_size + page_size - 1) & ~(page_size - 1);
+        auto heap = mmap(
+            nullptr,
+            _heap_mapping_size,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0);
+        if (heap == MAP_FAILED) {
+            r.error("B080", "unable to allocate the terp heap.");
+            return false;
+        }
+
+        _heap = reinterpret_cast<uint8_t*>(heap);
         _heap_address = reinterpret_cast<uint64_t>(_heap);
+        _stack_top = _heap_address + _heap_size;
 
         heap_vector(
             heap_vectors_t::top_of_stack,
@@ -3016,6 +3610,9 @@ namespace basecode::vm {
         heap_vector(
             heap_vectors_t::program_start,
             _heap_address + program_start);
+        _icache.initialize(
+            _heap_address + program_start,
+            _heap_address + program_start);
 
         _ffi->clear();
         reset();
@@ -3023,12 +3620,101 @@ namespace basecode::vm {
         return !r.is_failed();
     }
 
+    // the program region isn't written while a borrowed heap is in use, so
+    // the caches of each terp stay valid without invalidating one another
+    bool terp::initialize(
+            common::result& r,
+            const terp& source,
+            uint64_t stack_top) {
+        if (_heap != nullptr)
+            return true;
+
+        _heap = source._heap;
+        _heap_size = source._heap_size;
+        _heap_address = source._heap_address;
+        _heap_mapping_size = source._heap_mapping_size;
+        _shared_heap = true;
+        _stack_top = stack_top;
+        _traps = source._traps;
+        _address_regions = source._address_regions;
+        _big_endian = source._big_endian;
+        _swap_bytes = source._swap_bytes;
+
+        _threaded_engine.jit(source.jit());
+        _threaded_engine.lazy_flags(source.lazy_flags());
+        _threaded_engine.superinstructions(source.superinstructions());
+        _icache.initialize(
+            heap_vector(heap_vectors_t::program_start),
+            heap_vector(heap_vectors_t::free_space_start));
+
+        reset();
+
+        return !r.is_failed();
+    }
+
     void terp::register_trap(
             uint8_t index,
             const terp::trap_callable& callable) {
         _traps.insert(std::make_pair(index, callable));
     }
 
+    void terp::register_address_region(uint64_t address, size_t size) {
+        _address_regions.add(address, size);
+    }
+
+    const trace_ring& terp::trace() const {
+        return _trace;
+    }
+
+    bool terp::write_trace(
+            common::result& r,
+            const boost::filesystem::path& path) {
+        auto file = fopen(path.string().c_str(), "wt");
+        if (file == nullptr) {
+            r.error("B086", fmt::format("unable to write trace: {}", path.string()));
+            return false;
+        }
+
+        fmt::print(
+            file,
+            "PC =${:016X} | SP =${:016X} | FP =${:016X} | FR =${:016X}\n\n",
+            _registers.r[register_pc].qw,
+            _registers.r[register_sp].qw,
+            _registers.r[register_fp].qw,
+            _registers.r[register_fr].qw);
+        fmt::print(
+            file,
+            "last {} of {} control transfers, oldest first\n\n",
+            _trace.size(),
+            _trace.total());
+        fmt::print(file, "FROM               TO                 TARGET\n");
+
+        for (size_t i = _trace.size(); i > 0; i--) {
+            const auto& entry = _trace[i - 1];
+
+            // a wild jump is often why the trace is being written, so only
+            // targets inside the heap are decoded
+            std::string target {};
+            if (entry.to >= _heap_address
+            &&  entry.to + instruction_t::maximum_size <= _heap_address + _heap_size) {
+                instruction_t inst;
+                common::result decode_result {};
+                if (_icache.fetch_at(decode_result, entry.to, inst) != 0)
+                    target = common::rtrimmed(inst.disassemble());
+            }
+
+            fmt::print(
+                file,
+                "${:016X}  ${:016X}  {}\n",
+                entry.from,
+                entry.to,
+                target);
+        }
+
+        fclose(file);
+        return true;
+    }
+
     void terp::remove_trap(uint8_t index) {
         _traps.erase(index);
     }
@@ -3040,6 +3726,157 @@ namespace basecode::vm {
         it->second(this);
     }
 
+    bool terp::read_fiber(
+            common::result& r,
+            uint64_t handle,
+            fiber_t& fiber) {
+        if (!bounds_check_range(r, handle, sizeof(fiber_t)))
+            return false;
+        memcpy(&fiber, reinterpret_cast<const void*>(handle), sizeof(fiber_t));
+        return true;
+    }
+
+    void terp::write_fiber(
+            uint64_t handle,
+            const fiber_t& fiber) {
+        memcpy(reinterpret_cast<void*>(handle), &fiber, sizeof(fiber_t));
+    }
+
+    // the fiber starts out the way a call does: a zeroed return slot and a
+    // return address of zero on its own stack.  returning to zero finishes
+    // the fiber, see finish_fiber.
+    bool terp::create_fiber(
+            common::result& r,
+            uint64_t entry,
+            uint64_t stack_size,
+            uint64_t& handle) {
+        handle = _allocator->alloc(sizeof(fiber_t) + stack_size);
+        if (handle == 0) {
+            execute_trap(trap_out_of_memory);
+            return false;
+        }
+
+        auto stack_top = (handle + sizeof(fiber_t) + stack_size)
+            & ~static_cast<uint64_t>(sizeof(uint64_t) - 1);
+        if (stack_top < handle + sizeof(fiber_t) + (sizeof(uint64_t) * 2)) {
+            _allocator->free(handle);
+            r.error(
+                "B089",
+                fmt::format("fiber stack of {} bytes is too small.", stack_size));
+            return false;
+        }
+        write(op_sizes::qword, stack_top - sizeof(uint64_t), 0);
+        write(op_sizes::qword, stack_top - (sizeof(uint64_t) * 2), 0);
+
+        fiber_t fiber {};
+        fiber.registers.r[register_pc].qw = entry;
+        fiber.registers.r[register_sp].qw = stack_top - (sizeof(uint64_t) * 2);
+        write_fiber(handle, fiber);
+
+        return true;
+    }
+
+    // pc has already moved past the RESUME, so the saved registers continue
+    // with the next instruction once the fiber yields or finishes
+    bool terp::resume_fiber(
+            common::result& r,
+            uint64_t handle,
+            const operand_encoding_t& target,
+            op_sizes size) {
+        fiber_t fiber {};
+        if (!read_fiber(r, handle, fiber))
+            return false;
+
+        switch (fiber.state) {
+            case fiber_state_t::running: {
+                r.error(
+                    "B087",
+                    fmt::format("fiber ${:016X} is already running.", handle));
+                return false;
+            }
+            case fiber_state_t::finished: {
+                fiber.target = target;
+                fiber.target_size = size;
+                fiber.resumer_registers = _registers;
+                fiber.resumer = _current_fiber;
+                return return_from_fiber(r, handle, fiber);
+            }
+            default: {
+                break;
+            }
+        }
+
+        fiber.state = fiber_state_t::running;
+        fiber.target = target;
+        fiber.target_size = size;
+        fiber.resumer = _current_fiber;
+        fiber.resumer_registers = _registers;
+        write_fiber(handle, fiber);
+
+        _registers = fiber.registers;
+        _current_fiber = handle;
+
+        return true;
+    }
+
+    bool terp::yield_fiber(
+            common::result& r,
+            uint64_t value) {
+        if (_current_fiber == 0) {
+            r.error("B088", "yield outside of a fiber.");
+            return false;
+        }
+
+        auto handle = _current_fiber;
+        fiber_t fiber {};
+        if (!read_fiber(r, handle, fiber))
+            return false;
+
+        fiber.value = value;
+        fiber.registers = _registers;
+        fiber.state = fiber_state_t::suspended;
+        return return_from_fiber(r, handle, fiber);
+    }
+
+    // the fiber's entry procedure returned to address zero; its return
+    // value is in the slot the rts left on top of the stack
+    bool terp::finish_fiber(common::result& r) {
+        auto handle = _current_fiber;
+        fiber_t fiber {};
+        if (!read_fiber(r, handle, fiber))
+            return false;
+
+        fiber.value = read(op_sizes::qword, _registers.r[register_sp].qw);
+        fiber.registers = _registers;
+        fiber.state = fiber_state_t::finished;
+        return return_from_fiber(r, handle, fiber);
+    }
+
+    // carry tells the resumer the fiber has finished
+    bool terp::return_from_fiber(
+            common::result& r,
+            uint64_t handle,
+            const fiber_t& fiber) {
+        write_fiber(handle, fiber);
+        _registers = fiber.resumer_registers;
+        _current_fiber = fiber.resumer;
+
+        operand_value_t value;
+        value.alias.u = fiber.value;
+        if (!set_target_operand_value(r, fiber.target, fiber.target_size, value))
+            return false;
+
+        _registers.flags(register_file_t::flags_t::carry, fiber.state == fiber_state_t::finished);
+        _registers.flags(register_file_t::flags_t::subtract, false);
+        _registers.flags(register_file_t::flags_t::overflow, false);
+        _registers.flags(register_file_t::flags_t::zero, value.alias.u == 0);
+        _registers.flags(
+            register_file_t::flags_t::negative,
+            is_negative(value, fiber.target_size));
+
+        return true;
+    }
+
     std::vector<uint64_t> terp::jump_to_subroutine(
             common::result& r,
             uint64_t address) {
@@ -3073,6 +3910,10 @@ namespace basecode::vm {
         return _registers;
     }
 
+    const vector_register_file_t& terp::vector_register_file() const {
+        return _vector_registers;
+    }
+
     void terp::dump_heap(uint64_t offset, size_t size) {
         auto program_memory = common::hex_formatter::dump_to_string(
             reinterpret_cast<const void*>(_heap + offset),
@@ -3082,47 +3923,89 @@ namespace basecode::vm {
 
     void terp::heap_free_space_begin(uint64_t address) {
         heap_vector(heap_vectors_t::free_space_start, address);
+        _icache.initialize(heap_vector(heap_vectors_t::program_start), address);
+        _threaded_engine.reset();
         initialize_allocator();
     }
 
-    // XXX: need to add support for both big and little endian
+    bool terp::snapshot(
+            common::result& r,
+            heap_snapshot& snapshot) const {
+        if (!snapshot.write(r, _heap, _heap_mapping_size))
+            return false;
+
+        snapshot._exited = _exited;
+        snapshot._registers = _registers;
+        snapshot._current_fiber = _current_fiber;
+        snapshot._vector_registers = _vector_registers;
+        snapshot._address_regions = _address_regions;
+        _allocator->save(snapshot._allocator_state);
+
+        return true;
+    }
+
+    // the program region may differ from the one the caches were built
+    // from, so both engines start over
+    bool terp::restore(
+            common::result& r,
+            const heap_snapshot& snapshot) {
+        if (snapshot.empty() || snapshot.size() != _heap_mapping_size) {
+            r.error("B082", "heap snapshot doesn't match the terp heap.");
+            return false;
+        }
+
+        if (!snapshot.map(r, _heap))
+            return false;
+
+        _trace.reset();
+        _exited = snapshot._exited;
+        _registers = snapshot._registers;
+        _current_fiber = snapshot._current_fiber;
+        _vector_registers = snapshot._vector_registers;
+        _address_regions = snapshot._address_regions;
+        _allocator->restore(snapshot._allocator_state);
+
+        _icache.initialize(
+            heap_vector(heap_vectors_t::program_start),
+            heap_vector(heap_vectors_t::free_space_start));
+        _threaded_engine.reset();
+
+        return true;
+    }
+
+    bool terp::prime_instruction_cache(common::result& r, uint64_t address) {
+        instruction_t inst;
+        return _icache.fetch_at(r, address, inst) != 0;
+    }
+
     uint64_t terp::read(op_sizes size, uint64_t address) const {
-        uint8_t* heap_ptr = reinterpret_cast<uint8_t*>(address);
-        uint64_t result = 0;
-        auto result_ptr = reinterpret_cast<uint8_t*>(&result);
+        auto heap_ptr = reinterpret_cast<const void*>(address);
         switch (size) {
-            case op_sizes::none: {
-                break;
-            }
             case op_sizes::byte: {
-                *(result_ptr + 0) = *heap_ptr;
-                break;
+                uint8_t value;
+                memcpy(&value, heap_ptr, sizeof(uint8_t));
+                return value;
             }
             case op_sizes::word: {
-                *(result_ptr + 0) = heap_ptr[0];
-                *(result_ptr + 1) = heap_ptr[1];
-                break;
+                uint16_t value;
+                memcpy(&value, heap_ptr, sizeof(uint16_t));
+                return _swap_bytes ? common::endian_swap_word(value) : value;
             }
             case op_sizes::dword: {
-                *(result_ptr + 0) = heap_ptr[0];
-                *(result_ptr + 1) = heap_ptr[1];
-                *(result_ptr + 2) = heap_ptr[2];
-                *(result_ptr + 3) = heap_ptr[3];
-                break;
+                uint32_t value;
+                memcpy(&value, heap_ptr, sizeof(uint32_t));
+                return _swap_bytes ? common::endian_swap_dword(value) : value;
             }
             case op_sizes::qword: {
-                *(result_ptr + 0) = heap_ptr[0];
-                *(result_ptr + 1) = heap_ptr[1];
-                *(result_ptr + 2) = heap_ptr[2];
-                *(result_ptr + 3) = heap_ptr[3];
-                *(result_ptr + 4) = heap_ptr[4];
-                *(result_ptr + 5) = heap_ptr[5];
-                *(result_ptr + 6) = heap_ptr[6];
-                *(result_ptr + 7) = heap_ptr[7];
+                uint64_t value;
+                memcpy(&value, heap_ptr, sizeof(uint64_t));
+                return _swap_bytes ? common::endian_swap_qword(value) : value;
+            }
+            default: {
                 break;
             }
         }
-        return result;
+        return 0;
     }
 
     uint64_t terp::heap_vector(heap_vectors_t vector) const {
@@ -3287,8 +4170,6 @@ namespace basecode::vm {
         if (!get_operand_value(r, inst, address_index, address))
             return false;
 
-        auto is_white_listed = _white_listed_addresses.count(address.alias.u) > 0;
-
         if (inst.operands_count > 2) {
             operand_value_t offset;
 
@@ -3300,17 +4181,9 @@ namespace basecode::vm {
             } else {
                 address.alias.u += offset.alias.u;
             }
-
-            if(inst.op == op_codes::move
-            || inst.op == op_codes::moves
-            || inst.op == op_codes::movez) {
-                if (is_white_listed)
-                    _white_listed_addresses.insert(address.alias.u);
-            }
         }
 
-        if (!is_white_listed
-        && (inst.op == op_codes::load || inst.op == op_codes::store)) {
+        if (inst.op == op_codes::load || inst.op == op_codes::store) {
             if (!bounds_check_address(r, address))
                 return false;
         }
@@ -3318,6 +4191,48 @@ namespace basecode::vm {
         return true;
     }
 
+    bool terp::get_vector_register(
+            common::result& r,
+            const instruction_t& inst,
+            uint8_t operand_index,
+            vector_register_t*& reg) {
+        const auto& operand = inst.operands[operand_index];
+        if (!operand.is_reg()
+        ||  !operand.is_vector()
+        ||  operand.value.r >= number_vector_registers) {
+            r.error(
+                "B091",
+                fmt::format(
+                    "{} operand {} must be a vector register.",
+                    op_code_name(inst.op),
+                    operand_index));
+            return false;
+        }
+        reg = &_vector_registers.v[operand.value.r];
+        return true;
+    }
+
+    void terp::swap_vector_lanes(
+            vector_register_t& reg,
+            op_sizes size) const {
+        switch (size) {
+            case op_sizes::word:
+                for (size_t i = 0; i < vector_register_size / sizeof(uint16_t); i++)
+                    reg.w[i] = common::endian_swap_word(reg.w[i]);
+                break;
+            case op_sizes::dword:
+                for (size_t i = 0; i < vector_register_size / sizeof(uint32_t); i++)
+                    reg.dw[i] = common::endian_swap_dword(reg.dw[i]);
+                break;
+            case op_sizes::qword:
+                for (size_t i = 0; i < vector_register_size / sizeof(uint64_t); i++)
+                    reg.qw[i] = common::endian_swap_qword(reg.qw[i]);
+                break;
+            default:
+                break;
+        }
+    }
+
     bool terp::get_constant_address_or_pc_with_offset(
             common::result& r,
             const instruction_t& inst,
@@ -3378,42 +4293,45 @@ namespace basecode::vm {
         }
     }
 
-    // XXX: need to add support for both big and little endian
     void terp::write(op_sizes size, uint64_t address, uint64_t value) {
-        uint8_t* heap_ptr = reinterpret_cast<uint8_t*>(address);
-        auto value_ptr = reinterpret_cast<uint8_t*>(&value);
+        auto heap_ptr = reinterpret_cast<void*>(address);
         switch (size) {
-            case op_sizes::none: {
-                break;
-            }
             case op_sizes::byte: {
-                *heap_ptr = static_cast<uint8_t>(value);
+                auto byte_value = static_cast<uint8_t>(value);
+                memcpy(heap_ptr, &byte_value, sizeof(uint8_t));
                 break;
             }
             case op_sizes::word: {
-                *(heap_ptr + 0) = value_ptr[0];
-                *(heap_ptr + 1) = value_ptr[1];
+                auto word_value = static_cast<uint16_t>(value);
+                if (_swap_bytes)
+                    word_value = common::endian_swap_word(word_value);
+                memcpy(heap_ptr, &word_value, sizeof(uint16_t));
                 break;
             }
             case op_sizes::dword: {
-                *(heap_ptr + 0) = value_ptr[0];
-                *(heap_ptr + 1) = value_ptr[1];
-                *(heap_ptr + 2) = value_ptr[2];
-                *(heap_ptr + 3) = value_ptr[3];
+                auto dword_value = static_cast<uint32_t>(value);
+                if (_swap_bytes)
+                    dword_value = common::endian_swap_dword(dword_value);
+                memcpy(heap_ptr, &dword_value, sizeof(uint32_t));
                 break;
             }
             case op_sizes::qword: {
-                *(heap_ptr + 0) = value_ptr[0];
-                *(heap_ptr + 1) = value_ptr[1];
-                *(heap_ptr + 2) = value_ptr[2];
-                *(heap_ptr + 3) = value_ptr[3];
-                *(heap_ptr + 4) = value_ptr[4];
-                *(heap_ptr + 5) = value_ptr[5];
-                *(heap_ptr + 6) = value_ptr[6];
-                *(heap_ptr + 7) = value_ptr[7];
+                if (_swap_bytes)
+                    value = common::endian_swap_qword(value);
+                memcpy(heap_ptr, &value, sizeof(uint64_t));
                 break;
             }
+            default: {
+                return;
+            }
         }
+
+        invalidate_code(address, op_size_in_bytes(size));
+    }
+
+    void terp::invalidate_code(uint64_t address, size_t size) {
+        if (_icache.invalidate(address, size))
+            _threaded_engine.invalidate(address, size);
     }
 
     void terp::set_zoned_value(
@@ -13,6 +13,7 @@
 
 #include <map>
 #include <set>
+#include <array>
 #include <string>
 #include <memory>
 #include <cstdint>
@@ -22,14 +23,20 @@
 #include <common/result.h>
 #include <boost/filesystem.hpp>
 #include "vm_types.h"
+#include "threaded_engine.h"
 
 namespace basecode::vm {
 
     struct icache_entry_t {
-        size_t size;
-        instruction_t inst;
+        size_t size = 0;
+        instruction_t inst {};
     };
 
+    // the instruction cache is a dense table with one entry per aligned slot
+    // of the program region, indexed by (address - program start) / alignment.
+    // an entry with a size of zero hasn't been decoded yet.  addresses outside
+    // of the program region are decoded on every fetch.  writes into slots
+    // covered by a decoded instruction invalidate the overlapping entries.
     class instruction_cache {
     public:
         explicit instruction_cache(terp* terp);
@@ -41,11 +48,124 @@ namespace basecode::vm {
             uint64_t address,
             instruction_t& inst);
 
-        size_t fetch(common::result& r, instruction_t& inst);
+        bool invalidate(uint64_t address, size_t size);
+
+        void initialize(uint64_t start, uint64_t end);
+
+        const icache_entry_t* fetch(common::result& r);
+
+    private:
+        const icache_entry_t* entry_at(
+            common::result& r,
+            uint64_t address);
 
     private:
         terp* _terp = nullptr;
-        std::unordered_map<uint64_t, icache_entry_t> _cache {};
+        uint64_t _start = 0;
+        uint64_t _end = 0;
+        icache_entry_t _uncached {};
+        std::vector<uint8_t> _code_slots {};
+        std::vector<icache_entry_t> _entries {};
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    struct address_region_t {
+        uint64_t start = 0;
+        uint64_t end = 0;
+        uint64_t stamp = 0;
+    };
+
+    // address ranges outside of the vm heap that byte code may load from and
+    // store to, e.g. buffers returned by ffi calls.  regions are sorted and
+    // never overlap; a lookup checks the region of the previous hit before it
+    // falls back to a binary search.  once the table holds maximum_regions
+    // entries, the least recently added region is evicted.
+    class address_region_table {
+    public:
+        static constexpr size_t maximum_regions = 4096;
+
+        void reset();
+
+        bool empty() const;
+
+        bool contains(uint64_t address);
+
+        bool contains(uint64_t address, size_t size);
+
+        void add(uint64_t address, size_t size);
+
+    private:
+        void evict_oldest();
+
+    private:
+        size_t _last_hit = 0;
+        uint64_t _stamp = 0;
+        std::vector<address_region_t> _regions {};
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    struct trace_entry_t {
+        uint64_t from = 0;
+        uint64_t to = 0;
+    };
+
+    // the most recent control transfers a terp took: the address of each
+    // taken branch, jump, call or return and the address it went to.  the
+    // ring is only written by the thread running the terp, so recording is
+    // an index increment and two stores; once full, the oldest entry is
+    // overwritten.
+    class trace_ring {
+    public:
+        static constexpr size_t capacity = 1024;
+
+        static_assert((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+
+        void reset();
+
+        size_t size() const;
+
+        // transfers recorded since the last reset, including overwritten ones
+        uint64_t total() const;
+
+        inline void record(uint64_t from, uint64_t to) {
+            auto& entry = _entries[_head & (capacity - 1)];
+            entry.from = from;
+            entry.to = to;
+            ++_head;
+        }
+
+        // index zero is the most recent transfer
+        const trace_entry_t& operator[](size_t index) const;
+
+    private:
+        uint64_t _head = 0;
+        std::array<trace_entry_t, capacity> _entries {};
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    enum class fiber_state_t : uint64_t {
+        created,
+        suspended,
+        running,
+        finished
+    };
+
+    // the head of a fiber block.  FIBER allocates the block from the terp's
+    // allocator and the fiber's stack fills the rest of it; the handle byte
+    // code gets back is the block's address and FREE releases it.  the head
+    // holds the fiber's registers while it's suspended and its resumer's
+    // registers while it runs, so a switch is two register file copies.
+    struct fiber_t {
+        fiber_state_t state = fiber_state_t::created;
+        uint64_t resumer = 0;
+        uint64_t value = 0;
+        op_sizes target_size = op_sizes::qword;
+        operand_encoding_t target {};
+        register_file_t registers {};
+        register_file_t resumer_registers {};
     };
 
     ///////////////////////////////////////////////////////////////////////////
@@ -75,11 +195,15 @@ namespace basecode::vm {
         static constexpr uint8_t trap_invalid_ffi_call = 0xfe;
         static constexpr uint8_t trap_invalid_address = 0xfd;
 
+        // the ffi doesn't know the size of a returned buffer
+        static constexpr size_t ffi_pointer_region_size = 64 * 1024;
+
         terp(
             vm::ffi* ffi,
             vm::allocator* allocator,
             size_t heap_size,
-            size_t stack_size);
+            size_t stack_size,
+            execution_engine_t engine = execution_engine_t::stepped);
 
         virtual ~terp();
 
@@ -89,6 +213,15 @@ namespace basecode::vm {
 
         uint64_t peek() const;
 
+        // the byte order of values in the vm heap and on the stack.  ffi
+        // calls receive values in host order, but memory handed to native
+        // code through a pointer is left in the target order.  byte code
+        // that reads a narrower value than it stored, or than push wrote,
+        // only gets the low bits back in little endian mode.
+        bool big_endian() const;
+
+        void big_endian(bool value);
+
         bool has_exited() const;
 
         inline uint8_t* heap() {
@@ -97,18 +230,65 @@ namespace basecode::vm {
 
         size_t heap_size() const;
 
+        bool jit() const;
+
+        void jit(bool value);
+
+        bool lazy_flags() const;
+
+        void lazy_flags(bool value);
+
+        size_t fused_count() const;
+
+        size_t native_block_count() const;
+
+        bool superinstructions() const;
+
+        size_t superinstruction_count() const;
+
+        void superinstructions(bool value);
+
+        // when set, run counts every instruction into the profiler.  this
+        // runs through the stepped loop whatever the engine.
+        vm::profiler* profiler() const;
+
+        void profiler(vm::profiler* value);
+
         void push(uint64_t value);
 
         size_t stack_size() const;
 
+        bool swap_bytes() const;
+
         bool run(common::result& r);
 
         bool step(common::result& r);
 
+        bool execute(
+            common::result& r,
+            const instruction_t& inst,
+            uint64_t inst_size);
+
         void remove_trap(uint8_t index);
 
+        const trace_ring& trace() const;
+
+        // writes the trace ring, oldest transfer first, after the
+        // registers; bc calls this when byte code stops on a trap
+        bool write_trace(
+            common::result& r,
+            const boost::filesystem::path& path);
+
         bool initialize(common::result& r);
 
+        // borrows source's heap instead of mapping one: the program region,
+        // globals and traps are shared; the register file, caches, allocator
+        // and the stack ending at stack_top are this terp's own
+        bool initialize(
+            common::result& r,
+            const terp& source,
+            uint64_t stack_top);
+
         void dump_state(uint8_t count = 16);
 
         std::vector<uint64_t> jump_to_subroutine(
@@ -119,8 +299,23 @@ namespace basecode::vm {
 
         const register_file_t& register_file() const;
 
+        const vector_register_file_t& vector_register_file() const;
+
         void heap_free_space_begin(uint64_t address);
 
+        // copies the heap, registers and allocator state into snapshot
+        bool snapshot(
+            common::result& r,
+            heap_snapshot& snapshot) const;
+
+        // puts the terp back into the state snapshot holds; the heap pages
+        // are shared with the snapshot until they're written
+        bool restore(
+            common::result& r,
+            const heap_snapshot& snapshot);
+
+        bool prime_instruction_cache(common::result& r, uint64_t address);
+
         uint64_t heap_vector(heap_vectors_t vector) const;
 
         void dump_heap(uint64_t offset, size_t size = 256);
@@ -137,7 +332,12 @@ namespace basecode::vm {
 
         void register_trap(uint8_t index, const trap_callable& callable);
 
+        void register_address_region(uint64_t address, size_t size);
+
     private:
+        friend class terp_pool;
+        friend class threaded_engine;
+
         bool is_zero(
             op_sizes size,
             const operand_value_t& value);
@@ -169,6 +369,11 @@ namespace basecode::vm {
             common::result& r,
             const operand_value_t& address);
 
+        bool bounds_check_range(
+            common::result& r,
+            uint64_t address,
+            uint64_t size);
+
         void initialize_allocator();
 
         bool set_target_operand_value(
@@ -179,6 +384,44 @@ namespace basecode::vm {
 
         void execute_trap(uint8_t index);
 
+        bool run_profiled(common::result& r);
+
+        bool read_fiber(
+            common::result& r,
+            uint64_t handle,
+            fiber_t& fiber);
+
+        void write_fiber(
+            uint64_t handle,
+            const fiber_t& fiber);
+
+        bool create_fiber(
+            common::result& r,
+            uint64_t entry,
+            uint64_t stack_size,
+            uint64_t& handle);
+
+        bool resume_fiber(
+            common::result& r,
+            uint64_t handle,
+            const operand_encoding_t& target,
+            op_sizes size);
+
+        bool yield_fiber(
+            common::result& r,
+            uint64_t value);
+
+        bool finish_fiber(common::result& r);
+
+        bool return_from_fiber(
+            common::result& r,
+            uint64_t handle,
+            const fiber_t& fiber);
+
+        void call_foreign(const ffi_call_plan_t& plan);
+
+        void invalidate_code(uint64_t address, size_t size);
+
         bool get_address_with_offset(
             common::result& r,
             const instruction_t& inst,
@@ -186,6 +429,16 @@ namespace basecode::vm {
             uint8_t offset_index,
             operand_value_t& address);
 
+        bool get_vector_register(
+            common::result& r,
+            const instruction_t& inst,
+            uint8_t operand_index,
+            vector_register_t*& reg);
+
+        void swap_vector_lanes(
+            vector_register_t& reg,
+            op_sizes size) const;
+
         bool get_constant_address_or_pc_with_offset(
             common::result& r,
             const instruction_t& inst,
@@ -198,15 +451,26 @@ namespace basecode::vm {
     private:
         ffi* _ffi = nullptr;
         bool _exited = false;
+        bool _swap_bytes = false;
+        bool _big_endian = false;
+        bool _shared_heap = false;
         size_t _heap_size = 0;
         size_t _stack_size = 0;
+        size_t _heap_mapping_size = 0;
         uint8_t* _heap = nullptr;
         instruction_cache _icache;
+        execution_engine_t _engine;
+        threaded_engine _threaded_engine;
+        uint64_t _stack_top = 0;
+        uint64_t _current_fiber = 0;
         uint64_t _heap_address = 0;
         register_file_t _registers {};
+        vector_register_file_t _vector_registers {};
+        trace_ring _trace {};
         allocator* _allocator = nullptr;
+        vm::profiler* _profiler = nullptr;
         meta_information_t _meta_information {};
-        std::set<uint64_t> _white_listed_addresses {};
+        address_region_table _address_regions {};
         std::unordered_map<uint8_t, trap_callable> _traps {};
     };
 
@@ -0,0 +1,174 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#include <atomic>
+#include <thread>
+#include <fmt/format.h>
+#include "terp_pool.h"
+
+namespace basecode::vm {
+
+    terp_pool::terp_pool(
+        vm::terp* source,
+        size_t worker_count,
+        size_t stack_size,
+        size_t arena_size) : _stack_size(stack_size),
+                             _arena_size(arena_size),
+                             _worker_count(worker_count),
+                             _source(source) {
+    }
+
+    terp_pool::~terp_pool() {
+        release();
+    }
+
+    void terp_pool::release() {
+        for (auto& worker : _workers) {
+            worker.terp.reset();
+            if (worker.region != 0)
+                _source->_allocator->free(worker.region);
+        }
+        _workers.clear();
+    }
+
+    size_t terp_pool::size() const {
+        return _workers.size();
+    }
+
+    bool terp_pool::initialize(common::result& r) {
+        if (!_workers.empty())
+            return true;
+
+        auto worker_count = _worker_count;
+        if (worker_count == 0)
+            worker_count = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        auto stack_size = _stack_size & ~static_cast<size_t>(sizeof(uint64_t) - 1);
+        _workers.resize(worker_count);
+        for (auto& worker : _workers) {
+            worker.region = _source->_allocator->alloc(stack_size + _arena_size);
+            if (worker.region == 0) {
+                r.error(
+                    "B083",
+                    fmt::format(
+                        "unable to allocate {} bytes of stack and arena for a pooled terp.",
+                        stack_size + _arena_size));
+                release();
+                return false;
+            }
+
+            // the stack grows down toward the start of the region and the
+            // arena follows it
+            worker.allocator = std::make_unique<default_allocator>();
+            worker.allocator->initialize(worker.region + stack_size, _arena_size);
+
+            worker.ffi = std::make_unique<vm::ffi>(
+                _source->_ffi->heap_size(),
+                _source->_ffi);
+            if (!worker.ffi->initialize(r)) {
+                release();
+                return false;
+            }
+
+            worker.terp = std::make_unique<vm::terp>(
+                worker.ffi.get(),
+                worker.allocator.get(),
+                _source->_heap_size,
+                stack_size,
+                _source->_engine);
+            if (!worker.terp->initialize(r, *_source, worker.region + stack_size)) {
+                release();
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool terp_pool::run(
+            common::result& r,
+            terp_job_list_t& jobs) {
+        if (jobs.empty())
+            return true;
+
+        if (!initialize(r))
+            return false;
+
+        std::atomic<size_t> next_job(0);
+        auto thread_count = std::min(_workers.size(), jobs.size());
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count);
+        for (size_t i = 0; i < thread_count; i++) {
+            threads.emplace_back([&, i]() {
+                auto& worker = _workers[i];
+                while (true) {
+                    auto index = next_job.fetch_add(1);
+                    if (index >= jobs.size())
+                        break;
+                    execute(worker, jobs[index]);
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        for (const auto& job : jobs) {
+            for (const auto& msg : job.messages.messages()) {
+                switch (msg.type()) {
+                    case common::result_message::types::error:
+                        r.error(msg.code(), msg.message(), msg.location(), msg.details());
+                        break;
+                    case common::result_message::types::warning:
+                        r.warning(msg.code(), msg.message(), msg.location(), msg.details());
+                        break;
+                    default:
+                        r.info(msg.code(), msg.message(), msg.location(), msg.details());
+                        break;
+                }
+            }
+        }
+
+        return !r.is_failed();
+    }
+
+    // the job is called the way the byte code emitter calls a procedure: a
+    // zeroed return slot, then a return address.  the return address is
+    // zero, which is never inside the heap, so the job is done once pc
+    // comes back to it.
+    void terp_pool::execute(
+            worker_t& worker,
+            terp_job_t& job) {
+        auto& terp = *worker.terp;
+        terp.reset();
+        terp.push(0);
+        terp.push(0);
+        terp._registers.r[register_pc].qw = job.address;
+
+        auto& pc = terp._registers.r[register_pc].qw;
+        while (pc != 0 && !terp.has_exited()) {
+            if (!terp.step(job.messages))
+                break;
+        }
+
+        job.success = pc == 0 && !job.messages.is_failed();
+        if (job.success) {
+            job.result = terp.pop();
+        } else if (!job.messages.is_failed()) {
+            job.messages.error(
+                "B084",
+                fmt::format(
+                    "pooled terp job at ${:016X} didn't return.",
+                    job.address));
+        }
+    }
+
+};
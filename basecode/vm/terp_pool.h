@@ -0,0 +1,86 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <memory>
+#include "ffi.h"
+#include "terp.h"
+#include "default_allocator.h"
+
+namespace basecode::vm {
+
+    // a call into byte code: address is the entry point of a procedure that
+    // takes no arguments and returns one qword.  result and messages are
+    // filled in by whichever worker ran the job.
+    struct terp_job_t {
+        uint64_t address = 0;
+        uint64_t result = 0;
+        bool success = false;
+        common::result messages {};
+    };
+
+    using terp_job_list_t = std::vector<terp_job_t>;
+
+    // worker terps that run independent calls into one assembled program
+    // on separate threads.  every worker borrows the source terp's heap, so
+    // the program region and globals are shared and never copied; each one
+    // gets its own register file, caches, ffi call vm and a stack plus
+    // allocator arena carved out of the source's free space.
+    //
+    // jobs must not write to the program region or to memory another job
+    // reads.  the messages of each job are merged back in job order, so the
+    // result doesn't depend on which worker finished first.
+    class terp_pool {
+    public:
+        terp_pool(
+            vm::terp* source,
+            size_t worker_count,
+            size_t stack_size,
+            size_t arena_size);
+
+        terp_pool(const terp_pool&) = delete;
+
+        terp_pool& operator=(const terp_pool&) = delete;
+
+        ~terp_pool();
+
+        size_t size() const;
+
+        bool initialize(common::result& r);
+
+        bool run(
+            common::result& r,
+            terp_job_list_t& jobs);
+
+    private:
+        struct worker_t {
+            uint64_t region = 0;
+            std::unique_ptr<vm::ffi> ffi {};
+            std::unique_ptr<vm::terp> terp {};
+            std::unique_ptr<default_allocator> allocator {};
+        };
+
+        void release();
+
+        void execute(
+            worker_t& worker,
+            terp_job_t& job);
+
+    private:
+        size_t _stack_size;
+        size_t _arena_size;
+        size_t _worker_count;
+        vm::terp* _source = nullptr;
+        std::vector<worker_t> _workers {};
+    };
+
+};
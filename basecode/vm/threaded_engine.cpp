@@ -0,0 +1,1854 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#include <cstring>
+#include <unordered_map>
+#include <common/bytes.h>
+#include "ffi.h"
+#include "terp.h"
+#include "threaded_engine.h"
+
+namespace basecode::vm {
+
+    static constexpr uint64_t arithmetic_flags_mask = register_file_t::flags_t::zero
+        | register_file_t::flags_t::carry
+        | register_file_t::flags_t::overflow
+        | register_file_t::flags_t::negative
+        | register_file_t::flags_t::subtract;
+
+    static inline uint64_t operand_value(
+            const register_value_alias_t* regs,
+            const threaded_operand_t& operand) {
+        return operand.is_reg ? regs[operand.reg_index].qw : operand.value;
+    }
+
+    static inline void set_zoned_value(
+            register_value_alias_t& reg,
+            uint64_t value,
+            op_sizes size) {
+        switch (size) {
+            case op_sizes::byte:
+                reg.b = static_cast<uint8_t>(value);
+                break;
+            case op_sizes::word:
+                reg.w = static_cast<uint16_t>(value);
+                break;
+            case op_sizes::dword:
+                reg.dw = static_cast<uint32_t>(value);
+                break;
+            default:
+                reg.qw = value;
+                break;
+        }
+    }
+
+    static inline bool is_zero(op_sizes size, uint64_t value) {
+        switch (size) {
+            case op_sizes::byte:  return static_cast<uint8_t>(value) == 0;
+            case op_sizes::word:  return static_cast<uint16_t>(value) == 0;
+            case op_sizes::dword: return static_cast<uint32_t>(value) == 0;
+            case op_sizes::qword: return value == 0;
+            default:              return false;
+        }
+    }
+
+    static inline bool is_negative(op_sizes size, uint64_t value) {
+        switch (size) {
+            case op_sizes::byte:  return (value & terp::mask_byte_negative) != 0;
+            case op_sizes::word:  return (value & terp::mask_word_negative) != 0;
+            case op_sizes::dword: return (value & terp::mask_dword_negative) != 0;
+            default:              return (value & terp::mask_qword_negative) != 0;
+        }
+    }
+
+    static inline void set_flags(register_value_alias_t* regs, uint64_t flags) {
+        regs[register_fr].qw = (regs[register_fr].qw & ~arithmetic_flags_mask) | flags;
+    }
+
+    static inline uint64_t zero_negative_flags(op_sizes size, uint64_t zero_value, uint64_t sign_value) {
+        uint64_t flags = 0;
+        if (is_zero(size, zero_value))
+            flags |= register_file_t::flags_t::zero;
+        if (is_negative(size, sign_value))
+            flags |= register_file_t::flags_t::negative;
+        return flags;
+    }
+
+    template <op_sizes Size>
+    struct op_size_traits_t {
+    };
+
+    template <>
+    struct op_size_traits_t<op_sizes::byte> {
+        using type = uint8_t;
+        static constexpr uint64_t max = UINT8_MAX;
+        static constexpr uint64_t negative_mask = terp::mask_byte_negative;
+    };
+
+    template <>
+    struct op_size_traits_t<op_sizes::word> {
+        using type = uint16_t;
+        static constexpr uint64_t max = UINT16_MAX;
+        static constexpr uint64_t negative_mask = terp::mask_word_negative;
+    };
+
+    template <>
+    struct op_size_traits_t<op_sizes::dword> {
+        using type = uint32_t;
+        static constexpr uint64_t max = UINT32_MAX;
+        static constexpr uint64_t negative_mask = terp::mask_dword_negative;
+    };
+
+    template <>
+    struct op_size_traits_t<op_sizes::qword> {
+        using type = uint64_t;
+        static constexpr uint64_t max = UINT64_MAX;
+        static constexpr uint64_t negative_mask = terp::mask_qword_negative;
+    };
+
+    static inline bool condition_met(op_codes op, uint64_t fr) {
+        auto zf = (fr & register_file_t::flags_t::zero) != 0;
+        auto cf = (fr & register_file_t::flags_t::carry) != 0;
+        auto of = (fr & register_file_t::flags_t::overflow) != 0;
+        auto sf = (fr & register_file_t::flags_t::negative) != 0;
+        switch (op) {
+            case op_codes::beq:
+            case op_codes::setz:
+                return zf;
+            case op_codes::bne:
+            case op_codes::setnz:
+                return !zf;
+            case op_codes::bs:
+            case op_codes::sets:
+                return sf;
+            case op_codes::setns:
+                return !sf;
+            case op_codes::bo:
+            case op_codes::seto:
+                return of;
+            case op_codes::setno:
+                return !of;
+            case op_codes::ba:
+            case op_codes::seta:
+            case op_codes::setnbe:
+                return !zf && !cf;
+            case op_codes::bbe:
+            case op_codes::setna:
+            case op_codes::setbe:
+                return cf || zf;
+            case op_codes::bcc:
+            case op_codes::setnb:
+            case op_codes::setae:
+            case op_codes::setnc:
+                return !cf;
+            case op_codes::bae:
+            case op_codes::bcs:
+            case op_codes::bb:
+            case op_codes::setb:
+            case op_codes::setnae:
+            case op_codes::setc:
+                return cf;
+            case op_codes::bg:
+            case op_codes::setg:
+            case op_codes::setnle:
+                return !zf && sf == of;
+            case op_codes::bge:
+            case op_codes::setnl:
+            case op_codes::setge:
+                return sf == of;
+            case op_codes::bl:
+            case op_codes::setl:
+            case op_codes::setnge:
+                return sf != of;
+            case op_codes::ble:
+            case op_codes::setle:
+            case op_codes::setng:
+                return zf || sf != of;
+            default:
+                return false;
+        }
+    }
+
+    static bool is_alu_op(op_codes op) {
+        switch (op) {
+            case op_codes::add:
+            case op_codes::sub:
+            case op_codes::mul:
+            case op_codes::div:
+            case op_codes::mod:
+            case op_codes::shl:
+            case op_codes::shr:
+            case op_codes::and_op:
+            case op_codes::or_op:
+            case op_codes::xor_op:
+            case op_codes::cmp:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    static bool is_set_op(op_codes op) {
+        return op >= op_codes::seta && op <= op_codes::setnz;
+    }
+
+    template <op_codes Op, op_sizes Size>
+    static uint64_t alu_flags(uint64_t lhs, uint64_t rhs, uint64_t result) {
+        using traits = op_size_traits_t<Size>;
+        using value_t = typename traits::type;
+
+        auto lhs_value = static_cast<value_t>(lhs);
+        auto rhs_value = static_cast<value_t>(rhs);
+
+        uint64_t flags = 0;
+        if (static_cast<value_t>(result) == 0)
+            flags |= register_file_t::flags_t::zero;
+        if ((result & traits::negative_mask) != 0)
+            flags |= register_file_t::flags_t::negative;
+
+        auto overflow = ((~(lhs_value ^ rhs_value))
+            & (lhs_value ^ static_cast<value_t>(result))
+            & traits::negative_mask) != 0;
+        if constexpr (Op == op_codes::add
+                  ||  Op == op_codes::mul
+                  ||  Op == op_codes::div) {
+            if (lhs == traits::max && rhs > 0)
+                flags |= register_file_t::flags_t::carry;
+            if (overflow)
+                flags |= register_file_t::flags_t::overflow;
+        } else if constexpr (Op == op_codes::sub || Op == op_codes::cmp) {
+            flags |= register_file_t::flags_t::subtract;
+            if (lhs_value < rhs_value)
+                flags |= register_file_t::flags_t::carry;
+            else if (overflow)
+                flags |= register_file_t::flags_t::overflow;
+        }
+
+        return flags;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    template <op_codes Op, op_sizes Size, bool LhsIsReg, bool RhsIsReg, bool LazyFlags>
+    void threaded_engine::alu_handler(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op) {
+        using traits = op_size_traits_t<Size>;
+        using value_t = typename traits::type;
+
+        // cmp has no target operand
+        constexpr size_t lhs_index = Op == op_codes::cmp ? 0 : 1;
+        const auto& lhs_operand = op.operands[lhs_index];
+        const auto& rhs_operand = op.operands[lhs_index + 1];
+        uint64_t lhs = LhsIsReg ? regs[lhs_operand.reg_index].qw : lhs_operand.value;
+        uint64_t rhs = RhsIsReg ? regs[rhs_operand.reg_index].qw : rhs_operand.value;
+        auto lhs_value = static_cast<value_t>(lhs);
+        auto rhs_value = static_cast<value_t>(rhs);
+
+        uint64_t result = 0;
+        if constexpr (Op == op_codes::add) {
+            result = static_cast<uint64_t>(lhs_value + rhs_value);
+        } else if constexpr (Op == op_codes::sub || Op == op_codes::cmp) {
+            result = static_cast<uint64_t>(lhs_value - rhs_value);
+        } else if constexpr (Op == op_codes::mul) {
+            result = static_cast<uint64_t>(lhs_value * rhs_value);
+        } else if constexpr (Op == op_codes::div) {
+            if (rhs_value != 0)
+                result = static_cast<uint64_t>(lhs_value / rhs_value);
+        } else if constexpr (Op == op_codes::mod) {
+            if (lhs_value != 0 && rhs_value != 0)
+                result = static_cast<uint64_t>(lhs_value % rhs_value);
+        } else if constexpr (Op == op_codes::shl) {
+            result = static_cast<uint64_t>(lhs_value << rhs_value);
+        } else if constexpr (Op == op_codes::shr) {
+            result = static_cast<uint64_t>(lhs_value >> rhs_value);
+        } else if constexpr (Op == op_codes::and_op) {
+            result = static_cast<uint64_t>(lhs_value & rhs_value);
+        } else if constexpr (Op == op_codes::or_op) {
+            result = static_cast<uint64_t>(lhs_value | rhs_value);
+        } else if constexpr (Op == op_codes::xor_op) {
+            result = static_cast<uint64_t>(lhs_value ^ rhs_value);
+        }
+
+        if constexpr (Op != op_codes::cmp) {
+            auto& target = regs[op.operands[0].reg_index];
+            if constexpr (Size == op_sizes::byte)
+                target.b = static_cast<uint8_t>(result);
+            else if constexpr (Size == op_sizes::word)
+                target.w = static_cast<uint16_t>(result);
+            else if constexpr (Size == op_sizes::dword)
+                target.dw = static_cast<uint32_t>(result);
+            else
+                target.qw = result;
+        }
+
+        if constexpr (LazyFlags) {
+            auto& pending_flags = engine->_pending_flags;
+            pending_flags.compute = &alu_flags<Op, Size>;
+            pending_flags.lhs = lhs;
+            pending_flags.rhs = rhs;
+            pending_flags.result = result;
+        } else {
+            set_flags(regs, alu_flags<Op, Size>(lhs, rhs, result));
+        }
+    }
+
+    template <op_codes Op, bool LazyFlags>
+    alu_handler_t threaded_engine::alu_handler_for(
+            op_sizes size,
+            bool lhs_is_reg,
+            bool rhs_is_reg) {
+        static const alu_handler_t handlers[4][2][2] = {
+            {
+                {&alu_handler<Op, op_sizes::byte, false, false, LazyFlags>, &alu_handler<Op, op_sizes::byte, false, true, LazyFlags>},
+                {&alu_handler<Op, op_sizes::byte, true, false, LazyFlags>,  &alu_handler<Op, op_sizes::byte, true, true, LazyFlags>},
+            },
+            {
+                {&alu_handler<Op, op_sizes::word, false, false, LazyFlags>, &alu_handler<Op, op_sizes::word, false, true, LazyFlags>},
+                {&alu_handler<Op, op_sizes::word, true, false, LazyFlags>,  &alu_handler<Op, op_sizes::word, true, true, LazyFlags>},
+            },
+            {
+                {&alu_handler<Op, op_sizes::dword, false, false, LazyFlags>, &alu_handler<Op, op_sizes::dword, false, true, LazyFlags>},
+                {&alu_handler<Op, op_sizes::dword, true, false, LazyFlags>,  &alu_handler<Op, op_sizes::dword, true, true, LazyFlags>},
+            },
+            {
+                {&alu_handler<Op, op_sizes::qword, false, false, LazyFlags>, &alu_handler<Op, op_sizes::qword, false, true, LazyFlags>},
+                {&alu_handler<Op, op_sizes::qword, true, false, LazyFlags>,  &alu_handler<Op, op_sizes::qword, true, true, LazyFlags>},
+            },
+        };
+
+        size_t size_index;
+        switch (size) {
+            case op_sizes::byte:  size_index = 0; break;
+            case op_sizes::word:  size_index = 1; break;
+            case op_sizes::dword: size_index = 2; break;
+            case op_sizes::qword: size_index = 3; break;
+            default:              return nullptr;
+        }
+        return handlers[size_index][lhs_is_reg ? 1 : 0][rhs_is_reg ? 1 : 0];
+    }
+
+    template <op_codes Op>
+    alu_handler_t threaded_engine::alu_handler_for(
+            op_sizes size,
+            bool lhs_is_reg,
+            bool rhs_is_reg,
+            bool lazy_flags) {
+        return lazy_flags ?
+            alu_handler_for<Op, true>(size, lhs_is_reg, rhs_is_reg) :
+            alu_handler_for<Op, false>(size, lhs_is_reg, rhs_is_reg);
+    }
+
+    alu_handler_t threaded_engine::select_alu_handler(const threaded_op_t& op) const {
+        auto is_compare = op.inst.op == op_codes::cmp;
+        if (op.operands_count < (is_compare ? 2 : 3))
+            return nullptr;
+        if (!is_compare && !op.operands[0].is_reg)
+            return nullptr;
+
+        const auto& lhs = op.operands[is_compare ? 0 : 1];
+        const auto& rhs = op.operands[is_compare ? 1 : 2];
+        switch (op.inst.op) {
+            case op_codes::add:
+            case op_codes::sub:
+            case op_codes::mul:
+            case op_codes::div: {
+                // floating point arithmetic stays with terp::execute
+                if (!lhs.is_integer && !rhs.is_integer)
+                    return nullptr;
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+
+        switch (op.inst.op) {
+            case op_codes::add:    return alu_handler_for<op_codes::add>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            case op_codes::sub:    return alu_handler_for<op_codes::sub>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            case op_codes::mul:    return alu_handler_for<op_codes::mul>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            case op_codes::div:    return alu_handler_for<op_codes::div>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            case op_codes::mod:    return alu_handler_for<op_codes::mod>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            case op_codes::shl:    return alu_handler_for<op_codes::shl>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            case op_codes::shr:    return alu_handler_for<op_codes::shr>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            case op_codes::and_op: return alu_handler_for<op_codes::and_op>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            case op_codes::or_op:  return alu_handler_for<op_codes::or_op>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            case op_codes::xor_op: return alu_handler_for<op_codes::xor_op>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            case op_codes::cmp:    return alu_handler_for<op_codes::cmp>(op.size, lhs.is_reg, rhs.is_reg, _lazy_flags);
+            default:               return nullptr;
+        }
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    threaded_engine::threaded_engine(terp* terp) : _terp(terp) {
+    }
+
+    void threaded_engine::reset() {
+        clear_ops();
+        _program_start = 0;
+        _pending_flags.compute = nullptr;
+    }
+
+    bool threaded_engine::jit() const {
+        return _jit;
+    }
+
+    void threaded_engine::jit(bool value) {
+        value = value && native_code_buffer::is_supported();
+        if (_jit == value)
+            return;
+        _jit = value;
+        clear_ops();
+    }
+
+    bool threaded_engine::lazy_flags() const {
+        return _lazy_flags;
+    }
+
+    void threaded_engine::lazy_flags(bool value) {
+        if (_lazy_flags == value)
+            return;
+        materialize_flags();
+        _lazy_flags = value;
+        clear_ops();
+    }
+
+    size_t threaded_engine::fused_count() const {
+        return _fused_count;
+    }
+
+    size_t threaded_engine::native_block_count() const {
+        return _native_regions.size();
+    }
+
+    size_t threaded_engine::superinstruction_count() const {
+        return _superinstruction_count;
+    }
+
+    bool threaded_engine::superinstructions() const {
+        return _superinstructions;
+    }
+
+    void threaded_engine::superinstructions(bool value) {
+        if (_superinstructions == value)
+            return;
+        _superinstructions = value;
+        clear_ops();
+    }
+
+    void threaded_engine::materialize_flags() {
+        if (_pending_flags.compute == nullptr)
+            return;
+        set_flags(
+            _terp->_registers.r,
+            _pending_flags.compute(
+                _pending_flags.lhs,
+                _pending_flags.rhs,
+                _pending_flags.result));
+        _pending_flags.compute = nullptr;
+    }
+
+    void threaded_engine::clear_ops() {
+        _ops.clear();
+        _native_regions.clear();
+        _native_code.reset();
+    }
+
+    bool threaded_engine::in_heap(uint64_t address) const {
+        return address >= _terp->_heap_address
+            && address <= _terp->_heap_address + _terp->_heap_size;
+    }
+
+    void threaded_engine::invalidate(uint64_t address, size_t size) {
+        auto program_end = _program_start + _ops.size() * instruction_t::alignment;
+        if (_ops.empty() || address >= program_end || address + size <= _program_start)
+            return;
+
+        // an instruction or superinstruction that starts before the range may
+        // still overlap it
+        auto first = address < _program_start ? 0 : (address - _program_start) / instruction_t::alignment;
+        auto window = 3 * common::align(instruction_t::maximum_size, instruction_t::alignment)
+            / instruction_t::alignment;
+        auto index = first - std::min<uint64_t>(first, window);
+        auto last = std::min<uint64_t>(address + size, program_end);
+
+        // native blocks hold pointers to the ops they were compiled from
+        auto window_start = _program_start + index * instruction_t::alignment;
+        for (auto it = _native_regions.begin(); it != _native_regions.end();) {
+            if (it->start < last && it->end > window_start) {
+                _ops[it->entry].native = nullptr;
+                _ops[it->entry].hits = 0;
+                it = _native_regions.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        for (; _program_start + index * instruction_t::alignment < last; index++) {
+            auto& op = _ops[index];
+            auto extent = std::max<uint64_t>(op.inst_size, op.fused_size);
+            if (_program_start + index * instruction_t::alignment + extent > address) {
+                op.handler = _translate_handler;
+                op.inst_size = 0;
+                op.fused_size = 0;
+            }
+        }
+    }
+
+    bool threaded_engine::translate(
+            common::result& r,
+            uint64_t address,
+            threaded_op_t& op,
+            const void* const* handlers,
+            const void* generic_handler) {
+        auto inst_size = _terp->_icache.fetch_at(r, address, op.inst);
+        if (inst_size == 0)
+            return false;
+
+        const auto& inst = op.inst;
+        op.inst_size = static_cast<uint8_t>(inst_size);
+        op.fused_size = 0;
+        op.size = inst.size;
+        op.operands_count = inst.operands_count;
+
+        for (size_t i = 0; i < inst.operands_count; i++) {
+            const auto& encoding = inst.operands[i];
+            auto& operand = op.operands[i];
+            operand.is_reg = encoding.is_reg();
+            operand.is_integer = encoding.is_integer();
+            operand.is_negative = encoding.is_negative();
+            if (operand.is_reg) {
+                operand.reg_index = static_cast<uint8_t>(register_index(
+                    static_cast<registers_t>(encoding.value.r),
+                    operand.is_integer ?
+                        register_type_t::integer :
+                        register_type_t::floating_point));
+            } else {
+                register_value_alias_t alias {};
+                alias.qw = encoding.value.u;
+                switch (encoding.size) {
+                    case op_sizes::byte:  operand.value = alias.b;  break;
+                    case op_sizes::word:  operand.value = alias.w;  break;
+                    case op_sizes::dword: operand.value = alias.dw; break;
+                    default:              operand.value = alias.qw; break;
+                }
+            }
+        }
+
+        op.has_target = false;
+        switch (inst.op) {
+            case op_codes::bz:
+            case op_codes::bnz: {
+                if (!op.operands[1].is_reg) {
+                    op.has_target = true;
+                    op.target = op.operands[1].value;
+                }
+                break;
+            }
+            case op_codes::jsr:
+            case op_codes::jmp:
+            case op_codes::bne:
+            case op_codes::beq:
+            case op_codes::bs:
+            case op_codes::bo:
+            case op_codes::bcc:
+            case op_codes::bcs:
+            case op_codes::ba:
+            case op_codes::bae:
+            case op_codes::bb:
+            case op_codes::bbe:
+            case op_codes::bg:
+            case op_codes::bl:
+            case op_codes::bge:
+            case op_codes::ble: {
+                if (op.operands[0].is_reg)
+                    break;
+                if (inst.operands_count >= 2 && op.operands[1].is_reg)
+                    break;
+                op.has_target = true;
+                op.target = op.operands[0].value;
+                if (inst.operands_count >= 2) {
+                    if (op.operands[1].is_negative)
+                        op.target -= op.operands[1].value + inst_size;
+                    else
+                        op.target += op.operands[1].value - inst_size;
+                }
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+
+        op.alu = nullptr;
+        op.handler = handlers[static_cast<uint8_t>(inst.op)];
+        switch (inst.op) {
+            case op_codes::add:
+            case op_codes::sub:
+            case op_codes::mul:
+            case op_codes::div:
+            case op_codes::mod:
+            case op_codes::shl:
+            case op_codes::shr:
+            case op_codes::and_op:
+            case op_codes::or_op:
+            case op_codes::xor_op:
+            case op_codes::cmp: {
+                op.alu = select_alu_handler(op);
+                if (op.alu == nullptr)
+                    op.handler = generic_handler;
+                break;
+            }
+            case op_codes::load:
+            case op_codes::move:
+            case op_codes::pop:
+            case op_codes::seta:
+            case op_codes::setna:
+            case op_codes::setae:
+            case op_codes::setnae:
+            case op_codes::setb:
+            case op_codes::setnb:
+            case op_codes::setbe:
+            case op_codes::setnbe:
+            case op_codes::setc:
+            case op_codes::setnc:
+            case op_codes::setg:
+            case op_codes::setng:
+            case op_codes::setge:
+            case op_codes::setnge:
+            case op_codes::setl:
+            case op_codes::setnl:
+            case op_codes::setle:
+            case op_codes::setnle:
+            case op_codes::sets:
+            case op_codes::setns:
+            case op_codes::seto:
+            case op_codes::setno:
+            case op_codes::setz:
+            case op_codes::setnz: {
+                // a constant target is an error reported by terp::execute
+                if (inst.operands_count == 0 || !op.operands[0].is_reg)
+                    op.handler = generic_handler;
+                break;
+            }
+            case op_codes::ffi: {
+                // the call plan is looked up once here instead of on every
+                // call; an unknown function traps in terp::execute
+                op.ffi_plan = nullptr;
+                if (inst.operands_count > 0
+                &&  !op.operands[0].is_reg
+                &&  (inst.operands_count < 2 || !op.operands[1].is_reg)) {
+                    op.ffi_plan = _terp->_ffi->find_call_plan(
+                        op.operands[0].value,
+                        inst.operands_count > 1 ?
+                            static_cast<common::id_t>(op.operands[1].value) :
+                            0);
+                }
+                if (op.ffi_plan == nullptr)
+                    op.handler = generic_handler;
+                break;
+            }
+            default: {
+                break;
+            }
+        }
+
+        // the memory handlers copy host-order values, so a target byte order
+        // that differs from the host goes through terp::read and terp::write
+        if (_terp->swap_bytes()) {
+            switch (inst.op) {
+                case op_codes::load:
+                case op_codes::store:
+                case op_codes::push:
+                case op_codes::pop:
+                case op_codes::jsr:
+                case op_codes::rts: {
+                    op.handler = generic_handler;
+                    break;
+                }
+                default: {
+                    break;
+                }
+            }
+        }
+
+        // pc is kept in a local by dispatch and an explicit fr operand must
+        // observe materialized flags, so these go through terp::execute
+        if (op.handler != generic_handler) {
+            for (size_t i = 0; i < inst.operands_count; i++) {
+                if (!op.operands[i].is_reg)
+                    continue;
+                auto reg_index = op.operands[i].reg_index;
+                if (reg_index == register_pc
+                ||  (_lazy_flags && reg_index == register_fr)) {
+                    op.handler = generic_handler;
+                    break;
+                }
+            }
+        }
+
+        if (_superinstructions)
+            fuse(r, address, op, handlers, generic_handler);
+        return true;
+    }
+
+    size_t threaded_engine::peek(
+            common::result& r,
+            uint64_t address,
+            op_codes& op_code) {
+        auto offset = address - _program_start;
+        if (offset >= _ops.size() * instruction_t::alignment
+        ||  (offset % instruction_t::alignment) != 0) {
+            return 0;
+        }
+
+        const auto& op = _ops[offset / instruction_t::alignment];
+        if (op.handler != _translate_handler) {
+            op_code = op.inst.op;
+            return op.inst_size;
+        }
+
+        instruction_t inst {};
+        auto inst_size = _terp->_icache.fetch_at(r, address, inst);
+        op_code = inst.op;
+        return inst_size;
+    }
+
+    void threaded_engine::fuse(
+            common::result& r,
+            uint64_t address,
+            threaded_op_t& op,
+            const void* const* handlers,
+            const void* generic_handler) {
+        // the following instructions are only peeked at until they complete
+        // a sequence, so translating them can't recurse down the program
+        op_codes codes[3] {op.inst.op};
+        uint64_t addresses[3] {address};
+        size_t count = 1;
+        size_t inst_size = op.inst_size;
+        for (; count < 3; count++) {
+            addresses[count] = addresses[count - 1] + inst_size;
+            inst_size = peek(r, addresses[count], codes[count]);
+            if (inst_size == 0)
+                break;
+        }
+
+        size_t length = 0;
+        auto kind = superinstruction_t::count;
+        if (codes[0] == op_codes::load && count > 1 && is_alu_op(codes[1])) {
+            // leave a following cmp to fuse with its set* and branch
+            if (codes[1] == op_codes::cmp && count > 2 && is_set_op(codes[2]))
+                return;
+            if (count > 2 && codes[1] != op_codes::cmp && codes[2] == op_codes::store) {
+                kind = superinstruction_t::load_alu_store;
+                length = 3;
+            } else {
+                kind = superinstruction_t::load_alu;
+                length = 2;
+            }
+        } else if (codes[0] == op_codes::cmp
+               &&  count > 2
+               &&  is_set_op(codes[1])
+               &&  (codes[2] == op_codes::bz || codes[2] == op_codes::bnz)) {
+            kind = superinstruction_t::compare_branch;
+            length = 3;
+        } else if (is_alu_op(codes[0])
+               &&  codes[0] != op_codes::cmp
+               &&  count > 1
+               &&  codes[1] == op_codes::store) {
+            kind = superinstruction_t::alu_store;
+            length = 2;
+        } else {
+            return;
+        }
+
+        threaded_op_t* ops[3] {&op};
+        for (size_t i = 1; i < length; i++) {
+            auto& next = _ops[(addresses[i] - _program_start) / instruction_t::alignment];
+            if (next.handler == _translate_handler) {
+                if (!translate(r, addresses[i], next, handlers, generic_handler))
+                    return;
+            }
+            ops[i] = &next;
+        }
+
+        // every instruction in the sequence needs its dedicated handler
+        for (size_t i = 0; i < length; i++) {
+            if (ops[i]->handler != handlers[static_cast<uint8_t>(codes[i])]) {
+                if (kind != superinstruction_t::load_alu_store || i != 2)
+                    return;
+                kind = superinstruction_t::load_alu;
+                length = 2;
+                break;
+            }
+        }
+
+        uint64_t fused_size = 0;
+        for (size_t i = 0; i < length; i++)
+            fused_size += ops[i]->inst_size;
+        op.fused_size = static_cast<uint16_t>(fused_size);
+        op.handler = _fused_handlers[static_cast<size_t>(kind)];
+        _fused_count += length;
+        _superinstruction_count++;
+    }
+
+    static constexpr auto native_regs = x64_registers_t::rbx;
+
+    static constexpr auto native_engine = x64_registers_t::r12;
+
+    static bool names_register(const threaded_op_t& op, uint8_t reg_index) {
+        for (size_t i = 0; i < op.operands_count; i++) {
+            if (op.operands[i].is_reg && op.operands[i].reg_index == reg_index)
+                return true;
+        }
+        return false;
+    }
+
+    static int32_t register_displacement(uint32_t reg_index) {
+        return static_cast<int32_t>(reg_index * sizeof(register_value_alias_t));
+    }
+
+    static bool fits_in_int32(uint64_t value) {
+        auto signed_value = static_cast<int64_t>(value);
+        return signed_value >= INT32_MIN && signed_value <= INT32_MAX;
+    }
+
+    static void emit_operand_value(
+            x64_emitter& emitter,
+            x64_registers_t dest,
+            const threaded_operand_t& operand) {
+        if (operand.is_reg)
+            emitter.load(dest, native_regs, register_displacement(operand.reg_index), 8);
+        else
+            emitter.mov(dest, operand.value);
+    }
+
+    // leaves the base operand plus or minus the offset operand in dest and
+    // clobbers rcx
+    static void emit_effective_address(
+            x64_emitter& emitter,
+            x64_registers_t dest,
+            const threaded_op_t& op,
+            uint8_t base_index) {
+        emit_operand_value(emitter, dest, op.operands[base_index]);
+        if (op.operands_count <= 2)
+            return;
+
+        const auto& offset = op.operands[2];
+        auto alu_op = offset.is_negative ? x64_alu_ops_t::sub : x64_alu_ops_t::add;
+        if (!offset.is_reg && fits_in_int32(offset.value)) {
+            emitter.alu(alu_op, dest, static_cast<int32_t>(offset.value));
+        } else {
+            emit_operand_value(emitter, x64_registers_t::rcx, offset);
+            emitter.alu(alu_op, dest, x64_registers_t::rcx);
+        }
+    }
+
+    // the low bits of these results don't depend on the operand size, so
+    // they're computed in 64 bits and stored at the op size
+    static bool emit_inline_alu(x64_emitter& emitter, const threaded_op_t& op) {
+        auto alu_op = x64_alu_ops_t::add;
+        switch (op.inst.op) {
+            case op_codes::add:    alu_op = x64_alu_ops_t::add;    break;
+            case op_codes::sub:    alu_op = x64_alu_ops_t::sub;    break;
+            case op_codes::and_op: alu_op = x64_alu_ops_t::and_op; break;
+            case op_codes::or_op:  alu_op = x64_alu_ops_t::or_op;  break;
+            case op_codes::xor_op: alu_op = x64_alu_ops_t::xor_op; break;
+            case op_codes::mul:    break;
+            default:               return false;
+        }
+
+        const auto& rhs = op.operands[2];
+        emit_operand_value(emitter, x64_registers_t::rax, op.operands[1]);
+        if (op.inst.op == op_codes::mul) {
+            emit_operand_value(emitter, x64_registers_t::rcx, rhs);
+            emitter.imul(x64_registers_t::rax, x64_registers_t::rcx);
+        } else if (!rhs.is_reg && fits_in_int32(rhs.value)) {
+            emitter.alu(alu_op, x64_registers_t::rax, static_cast<int32_t>(rhs.value));
+        } else {
+            emit_operand_value(emitter, x64_registers_t::rcx, rhs);
+            emitter.alu(alu_op, x64_registers_t::rax, x64_registers_t::rcx);
+        }
+        emitter.store(
+            native_regs,
+            register_displacement(op.operands[0].reg_index),
+            x64_registers_t::rax,
+            op_size_in_bytes(op.size));
+        return true;
+    }
+
+    static bool is_native_terminator(op_codes op) {
+        switch (op) {
+            case op_codes::jmp:
+            case op_codes::jsr:
+            case op_codes::rts:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // ops the native block can't run itself: these end the region and make
+    // dispatch interpret them
+    static bool is_native_deopt(const threaded_op_t& op, const void* generic_handler) {
+        if (op.handler == generic_handler)
+            return true;
+        switch (op.inst.op) {
+            case op_codes::nop:
+            case op_codes::load:
+            case op_codes::store:
+            case op_codes::move:
+            case op_codes::push:
+            case op_codes::pop:
+            case op_codes::rts:
+                return false;
+            case op_codes::bz:
+            case op_codes::bnz:
+            case op_codes::jmp:
+            case op_codes::jsr:
+            case op_codes::bne:
+            case op_codes::beq:
+            case op_codes::bs:
+            case op_codes::bo:
+            case op_codes::bcc:
+            case op_codes::bcs:
+            case op_codes::ba:
+            case op_codes::bae:
+            case op_codes::bb:
+            case op_codes::bbe:
+            case op_codes::bg:
+            case op_codes::bl:
+            case op_codes::bge:
+            case op_codes::ble:
+                return !op.has_target;
+            default:
+                return !is_alu_op(op.inst.op) && !is_set_op(op.inst.op);
+        }
+    }
+
+    static uint64_t effective_address(
+            const register_value_alias_t* regs,
+            const threaded_op_t& op,
+            uint8_t base_index) {
+        auto address = operand_value(regs, op.operands[base_index]);
+        if (op.operands_count > 2) {
+            auto offset = operand_value(regs, op.operands[2]);
+            if (op.operands[2].is_negative)
+                address -= offset;
+            else
+                address += offset;
+        }
+        return address;
+    }
+
+    bool threaded_engine::native_load(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op) {
+        auto address = effective_address(regs, op, 1);
+        if (!engine->in_heap(address))
+            return false;
+        uint64_t value = 0;
+        memcpy(&value, reinterpret_cast<void*>(address), op_size_in_bytes(op.size));
+        set_zoned_value(regs[op.operands[0].reg_index], value, op.size);
+        engine->_pending_flags.compute = nullptr;
+        set_flags(regs, zero_negative_flags(op.size, value, value));
+        return true;
+    }
+
+    // returns zero to continue, or the value the native block exits with:
+    // a deopt of the store itself, or the next address once a store into
+    // the program region has invalidated native code
+    uint64_t threaded_engine::native_store(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op) {
+        auto pc = engine->_program_start + (&op - engine->_ops.data()) * instruction_t::alignment;
+        auto next_pc = pc + op.inst_size;
+        auto address = effective_address(regs, op, 0);
+        if (!engine->in_heap(address))
+            return pc | native_deopt_bit;
+
+        auto value = operand_value(regs, op.operands[1]);
+        auto size = op_size_in_bytes(op.size);
+        memcpy(reinterpret_cast<void*>(address), &value, size);
+        engine->_pending_flags.compute = nullptr;
+        set_flags(regs, zero_negative_flags(op.size, value, value));
+
+        auto program_size = engine->_ops.size() * instruction_t::alignment;
+        if (address - engine->_program_start < program_size) {
+            auto region_count = engine->_native_regions.size();
+            engine->_terp->invalidate_code(address, size);
+            if (engine->_native_regions.size() != region_count)
+                return next_pc;
+        }
+        return 0;
+    }
+
+    void threaded_engine::native_move(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op) {
+        auto source = operand_value(regs, op.operands[1]);
+        set_zoned_value(regs[op.operands[0].reg_index], effective_address(regs, op, 1), op.size);
+        uint64_t flags = 0;
+        if (source == 0)
+            flags |= register_file_t::flags_t::zero;
+        if (is_negative(op.size, source))
+            flags |= register_file_t::flags_t::negative;
+        engine->_pending_flags.compute = nullptr;
+        set_flags(regs, flags);
+    }
+
+    void threaded_engine::native_push(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op) {
+        auto value = operand_value(regs, op.operands[0]);
+        regs[register_sp].qw -= sizeof(uint64_t);
+        memcpy(reinterpret_cast<void*>(regs[register_sp].qw), &value, sizeof(uint64_t));
+        uint64_t flags = 0;
+        if (value == 0)
+            flags |= register_file_t::flags_t::zero;
+        if (is_negative(op.size, value))
+            flags |= register_file_t::flags_t::negative;
+        engine->_pending_flags.compute = nullptr;
+        set_flags(regs, flags);
+    }
+
+    void threaded_engine::native_pop(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op) {
+        uint64_t value = 0;
+        memcpy(&value, reinterpret_cast<void*>(regs[register_sp].qw), sizeof(uint64_t));
+        regs[register_sp].qw += sizeof(uint64_t);
+        set_zoned_value(regs[op.operands[0].reg_index], value, op.size);
+        uint64_t flags = 0;
+        if (value == 0)
+            flags |= register_file_t::flags_t::zero;
+        if (is_negative(op.size, value))
+            flags |= register_file_t::flags_t::negative;
+        engine->_pending_flags.compute = nullptr;
+        set_flags(regs, flags);
+    }
+
+    void threaded_engine::native_set(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op) {
+        engine->materialize_flags();
+        set_zoned_value(
+            regs[op.operands[0].reg_index],
+            condition_met(op.inst.op, regs[register_fr].qw) ? 1 : 0,
+            op.size);
+    }
+
+    bool threaded_engine::native_branch_if_zero(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op) {
+        auto value = operand_value(regs, op.operands[0]);
+        auto flags = zero_negative_flags(op.size, value, value);
+        engine->_pending_flags.compute = nullptr;
+        set_flags(regs, flags);
+        auto is_zero_value = (flags & register_file_t::flags_t::zero) != 0;
+        return is_zero_value == (op.inst.op == op_codes::bz);
+    }
+
+    bool threaded_engine::native_condition_met(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op) {
+        engine->materialize_flags();
+        return condition_met(op.inst.op, regs[register_fr].qw);
+    }
+
+    void threaded_engine::native_push_return(
+            register_value_alias_t* regs,
+            uint64_t return_address) {
+        regs[register_sp].qw -= sizeof(uint64_t);
+        memcpy(reinterpret_cast<void*>(regs[register_sp].qw), &return_address, sizeof(uint64_t));
+    }
+
+    uint64_t threaded_engine::native_pop_return(register_value_alias_t* regs) {
+        uint64_t return_address = 0;
+        memcpy(&return_address, reinterpret_cast<void*>(regs[register_sp].qw), sizeof(uint64_t));
+        regs[register_sp].qw += sizeof(uint64_t);
+        return return_address;
+    }
+
+    void threaded_engine::compile_native(
+            uint64_t address,
+            const void* const* handlers,
+            const void* generic_handler) {
+        // translation errors are left for dispatch to report if it ever
+        // reaches the instruction
+        common::result scratch;
+
+        auto program_size = _ops.size() * instruction_t::alignment;
+        auto program_end = _program_start + program_size;
+        std::vector<size_t> region {};
+        auto next_address = address;
+        while (region.size() < maximum_native_region && next_address < program_end) {
+            auto index = (next_address - _program_start) / instruction_t::alignment;
+            auto& op = _ops[index];
+            if (op.handler == _translate_handler) {
+                if (!translate(scratch, next_address, op, handlers, generic_handler))
+                    break;
+            }
+            region.push_back(index);
+            next_address += op.inst_size;
+            if (is_native_deopt(op, generic_handler) || is_native_terminator(op.inst.op))
+                break;
+        }
+
+        if (region.empty() || is_native_deopt(_ops[region.front()], generic_handler))
+            return;
+
+        // flags are live wherever control can leave the straight line, so
+        // an instruction whose flags are overwritten before anything reads
+        // them can skip computing them
+        std::vector<bool> flags_live(region.size());
+        auto live = true;
+        for (size_t i = region.size(); i-- > 0;) {
+            const auto& op = _ops[region[i]];
+            flags_live[i] = live;
+            if (is_native_deopt(op, generic_handler) || names_register(op, register_fr)) {
+                live = true;
+                continue;
+            }
+            switch (op.inst.op) {
+                case op_codes::nop: {
+                    break;
+                }
+                case op_codes::load:
+                case op_codes::store:
+                case op_codes::move:
+                case op_codes::push:
+                case op_codes::pop: {
+                    live = false;
+                    break;
+                }
+                case op_codes::bz:
+                case op_codes::bnz: {
+                    flags_live[i] = true;
+                    live = false;
+                    break;
+                }
+                default: {
+                    live = !is_alu_op(op.inst.op);
+                    break;
+                }
+            }
+        }
+
+        // rbx holds the register file and r12 the engine for the whole block;
+        // both are callee saved, so the handler calls leave them alone
+        x64_emitter emitter;
+        emitter.push(native_regs);
+        emitter.push(native_engine);
+        emitter.alu(x64_alu_ops_t::sub, x64_registers_t::rsp, 8);
+        emitter.mov(native_engine, x64_registers_t::rdi);
+        emitter.mov(native_regs, x64_registers_t::rsi);
+
+        auto emit_call = [&](const void* function, const threaded_op_t& op) {
+            emitter.mov(x64_registers_t::rdi, native_engine);
+            emitter.mov(x64_registers_t::rsi, native_regs);
+            emitter.mov(x64_registers_t::rdx, reinterpret_cast<uint64_t>(&op));
+            emitter.mov(x64_registers_t::rax, reinterpret_cast<uint64_t>(function));
+            emitter.call(x64_registers_t::rax);
+        };
+
+        // each jump is resolved once the region is emitted: either to the
+        // native code of an instruction inside the region or to an exit
+        struct jump_t {
+            size_t at = 0;
+            uint64_t target = 0;
+        };
+        std::vector<jump_t> jumps {};
+        std::vector<size_t> epilogue_jumps {};
+        std::unordered_map<uint64_t, size_t> offsets {};
+
+        auto emit_heap_check = [&](uint64_t deopt_target) {
+            emitter.mov(x64_registers_t::rcx, _terp->_heap_address);
+            emitter.alu(x64_alu_ops_t::cmp, x64_registers_t::rax, x64_registers_t::rcx);
+            jumps.push_back({emitter.jcc_rel32(x64_conditions_t::below), deopt_target});
+            emitter.mov(x64_registers_t::rcx, _terp->_heap_address + _terp->_heap_size);
+            emitter.alu(x64_alu_ops_t::cmp, x64_registers_t::rax, x64_registers_t::rcx);
+            jumps.push_back({emitter.jcc_rel32(x64_conditions_t::above), deopt_target});
+        };
+
+        auto pc = address;
+        auto falls_through = true;
+        for (size_t i = 0; i < region.size(); i++) {
+            const auto& op = _ops[region[i]];
+            offsets[pc] = emitter.offset();
+            auto next_pc = pc + op.inst_size;
+            auto deopt_target = pc | native_deopt_bit;
+            auto width = op_size_in_bytes(op.size);
+            auto inline_op = !flags_live[i] && width != 0 && !names_register(op, register_fr);
+
+            if (is_native_deopt(op, generic_handler)) {
+                emitter.mov(x64_registers_t::rax, deopt_target);
+                epilogue_jumps.push_back(emitter.jmp_rel32());
+                falls_through = false;
+                break;
+            }
+
+            switch (op.inst.op) {
+                case op_codes::nop: {
+                    break;
+                }
+                case op_codes::load: {
+                    if (!inline_op) {
+                        emit_call(reinterpret_cast<const void*>(&native_load), op);
+                        emitter.test(x64_registers_t::rax, 1);
+                        jumps.push_back({emitter.jcc_rel32(x64_conditions_t::zero), deopt_target});
+                        break;
+                    }
+                    emit_effective_address(emitter, x64_registers_t::rax, op, 1);
+                    emit_heap_check(deopt_target);
+                    emitter.load(x64_registers_t::rdx, x64_registers_t::rax, 0, width);
+                    emitter.store(
+                        native_regs,
+                        register_displacement(op.operands[0].reg_index),
+                        x64_registers_t::rdx,
+                        width);
+                    break;
+                }
+                case op_codes::store: {
+                    size_t done_jump = 0;
+                    if (inline_op) {
+                        // stores into the program region take the helper,
+                        // which invalidates code
+                        emit_effective_address(emitter, x64_registers_t::rax, op, 0);
+                        emit_heap_check(deopt_target);
+                        emitter.mov(x64_registers_t::rcx, x64_registers_t::rax);
+                        emitter.mov(x64_registers_t::rdx, _program_start);
+                        emitter.alu(x64_alu_ops_t::sub, x64_registers_t::rcx, x64_registers_t::rdx);
+                        emitter.mov(x64_registers_t::rdx, program_size);
+                        emitter.alu(x64_alu_ops_t::cmp, x64_registers_t::rcx, x64_registers_t::rdx);
+                        auto slow_jump = emitter.jcc_rel32(x64_conditions_t::below);
+                        emit_operand_value(emitter, x64_registers_t::rdx, op.operands[1]);
+                        emitter.store(x64_registers_t::rax, 0, x64_registers_t::rdx, width);
+                        done_jump = emitter.jmp_rel32();
+                        emitter.patch_rel32(slow_jump, emitter.offset());
+                    }
+                    emit_call(reinterpret_cast<const void*>(&native_store), op);
+                    emitter.test(x64_registers_t::rax, 8);
+                    epilogue_jumps.push_back(emitter.jcc_rel32(x64_conditions_t::not_zero));
+                    if (inline_op)
+                        emitter.patch_rel32(done_jump, emitter.offset());
+                    break;
+                }
+                case op_codes::move: {
+                    if (!inline_op) {
+                        emit_call(reinterpret_cast<const void*>(&native_move), op);
+                        break;
+                    }
+                    emit_effective_address(emitter, x64_registers_t::rax, op, 1);
+                    emitter.store(
+                        native_regs,
+                        register_displacement(op.operands[0].reg_index),
+                        x64_registers_t::rax,
+                        width);
+                    break;
+                }
+                case op_codes::push: {
+                    if (!inline_op) {
+                        emit_call(reinterpret_cast<const void*>(&native_push), op);
+                        break;
+                    }
+                    auto sp = register_displacement(register_sp);
+                    emit_operand_value(emitter, x64_registers_t::rax, op.operands[0]);
+                    emitter.load(x64_registers_t::rcx, native_regs, sp, 8);
+                    emitter.alu(x64_alu_ops_t::sub, x64_registers_t::rcx, sizeof(uint64_t));
+                    emitter.store(native_regs, sp, x64_registers_t::rcx, 8);
+                    emitter.store(x64_registers_t::rcx, 0, x64_registers_t::rax, 8);
+                    break;
+                }
+                case op_codes::pop: {
+                    if (!inline_op) {
+                        emit_call(reinterpret_cast<const void*>(&native_pop), op);
+                        break;
+                    }
+                    auto sp = register_displacement(register_sp);
+                    emitter.load(x64_registers_t::rcx, native_regs, sp, 8);
+                    emitter.load(x64_registers_t::rax, x64_registers_t::rcx, 0, 8);
+                    emitter.alu(x64_alu_ops_t::add, x64_registers_t::rcx, sizeof(uint64_t));
+                    emitter.store(native_regs, sp, x64_registers_t::rcx, 8);
+                    emitter.store(
+                        native_regs,
+                        register_displacement(op.operands[0].reg_index),
+                        x64_registers_t::rax,
+                        width);
+                    break;
+                }
+                case op_codes::bz:
+                case op_codes::bnz: {
+                    emit_call(reinterpret_cast<const void*>(&native_branch_if_zero), op);
+                    emitter.test(x64_registers_t::rax, 1);
+                    jumps.push_back({emitter.jcc_rel32(x64_conditions_t::not_zero), op.target});
+                    break;
+                }
+                case op_codes::jmp: {
+                    jumps.push_back({emitter.jmp_rel32(), op.target});
+                    break;
+                }
+                case op_codes::jsr: {
+                    emitter.mov(x64_registers_t::rdi, native_regs);
+                    emitter.mov(x64_registers_t::rsi, next_pc);
+                    emitter.mov(
+                        x64_registers_t::rax,
+                        reinterpret_cast<uint64_t>(&native_push_return));
+                    emitter.call(x64_registers_t::rax);
+                    jumps.push_back({emitter.jmp_rel32(), op.target});
+                    break;
+                }
+                case op_codes::rts: {
+                    emitter.mov(x64_registers_t::rdi, native_regs);
+                    emitter.mov(
+                        x64_registers_t::rax,
+                        reinterpret_cast<uint64_t>(&native_pop_return));
+                    emitter.call(x64_registers_t::rax);
+                    epilogue_jumps.push_back(emitter.jmp_rel32());
+                    break;
+                }
+                default: {
+                    if (is_set_op(op.inst.op)) {
+                        emit_call(reinterpret_cast<const void*>(&native_set), op);
+                    } else if (!is_alu_op(op.inst.op)) {
+                        emit_call(reinterpret_cast<const void*>(&native_condition_met), op);
+                        emitter.test(x64_registers_t::rax, 1);
+                        jumps.push_back({emitter.jcc_rel32(x64_conditions_t::not_zero), op.target});
+                    } else if (op.inst.op == op_codes::cmp && inline_op) {
+                        // only writes flags, and nothing reads them
+                    } else if (!inline_op || !emit_inline_alu(emitter, op)) {
+                        emit_call(reinterpret_cast<const void*>(op.alu), op);
+                    }
+                    break;
+                }
+            }
+
+            pc = next_pc;
+            if (is_native_terminator(op.inst.op)) {
+                falls_through = false;
+                break;
+            }
+        }
+
+        if (falls_through) {
+            emitter.mov(x64_registers_t::rax, pc);
+            epilogue_jumps.push_back(emitter.jmp_rel32());
+        }
+
+        std::unordered_map<uint64_t, size_t> exits {};
+        for (const auto& jump : jumps) {
+            auto it = offsets.find(jump.target);
+            if (it != offsets.end()) {
+                emitter.patch_rel32(jump.at, it->second);
+                continue;
+            }
+            auto exit_it = exits.find(jump.target);
+            if (exit_it == exits.end()) {
+                exit_it = exits.insert(std::make_pair(jump.target, emitter.offset())).first;
+                emitter.mov(x64_registers_t::rax, jump.target);
+                epilogue_jumps.push_back(emitter.jmp_rel32());
+            }
+            emitter.patch_rel32(jump.at, exit_it->second);
+        }
+
+        auto epilogue = emitter.offset();
+        emitter.alu(x64_alu_ops_t::add, x64_registers_t::rsp, 8);
+        emitter.pop(native_engine);
+        emitter.pop(native_regs);
+        emitter.ret();
+        for (auto at : epilogue_jumps)
+            emitter.patch_rel32(at, epilogue);
+
+        auto entry = _native_code.write(emitter.data(), emitter.offset());
+        if (entry == nullptr)
+            return;
+
+        _ops[region.front()].native = reinterpret_cast<native_block_t>(const_cast<void*>(entry));
+        _native_regions.push_back(native_region_t {
+            region.front(),
+            address,
+            pc});
+    }
+
+    void threaded_engine::allocate_ops(const void* translate_handler) {
+        _translate_handler = translate_handler;
+        _program_start = _terp->heap_vector(heap_vectors_t::program_start);
+        auto program_end = _terp->heap_vector(heap_vectors_t::free_space_start);
+        auto count = program_end > _program_start ?
+            (program_end - _program_start) / instruction_t::alignment :
+            0;
+        _ops.resize(count);
+        for (auto& op : _ops)
+            op.handler = translate_handler;
+    }
+
+    bool threaded_engine::run(common::result& r) {
+        auto success = dispatch(r);
+        materialize_flags();
+        return success;
+    }
+
+    bool threaded_engine::dispatch(common::result& r) {
+        if (_terp->_exited)
+            return true;
+
+        const void* handlers[256];
+        for (auto& handler : handlers)
+            handler = &&op_generic;
+
+        handlers[static_cast<uint8_t>(op_codes::nop)] = &&op_nop;
+        handlers[static_cast<uint8_t>(op_codes::load)] = &&op_load;
+        handlers[static_cast<uint8_t>(op_codes::store)] = &&op_store;
+        handlers[static_cast<uint8_t>(op_codes::move)] = &&op_move;
+        handlers[static_cast<uint8_t>(op_codes::push)] = &&op_push;
+        handlers[static_cast<uint8_t>(op_codes::pop)] = &&op_pop;
+        handlers[static_cast<uint8_t>(op_codes::bz)] = &&op_bz;
+        handlers[static_cast<uint8_t>(op_codes::bnz)] = &&op_bnz;
+        handlers[static_cast<uint8_t>(op_codes::jsr)] = &&op_jsr;
+        handlers[static_cast<uint8_t>(op_codes::rts)] = &&op_rts;
+        handlers[static_cast<uint8_t>(op_codes::jmp)] = &&op_jmp;
+        handlers[static_cast<uint8_t>(op_codes::exit)] = &&op_exit;
+        handlers[static_cast<uint8_t>(op_codes::ffi)] = &&op_ffi;
+        for (auto alu_op : {op_codes::add, op_codes::sub, op_codes::mul, op_codes::div,
+                            op_codes::mod, op_codes::shl, op_codes::shr, op_codes::and_op,
+                            op_codes::or_op, op_codes::xor_op, op_codes::cmp}) {
+            handlers[static_cast<uint8_t>(alu_op)] = &&op_alu;
+        }
+        for (auto branch_op : {op_codes::bne, op_codes::beq, op_codes::bs, op_codes::bo,
+                               op_codes::bcc, op_codes::bcs, op_codes::ba, op_codes::bae,
+                               op_codes::bb, op_codes::bbe, op_codes::bg, op_codes::bl,
+                               op_codes::bge, op_codes::ble}) {
+            handlers[static_cast<uint8_t>(branch_op)] = &&op_branch;
+        }
+        for (auto set_op : {op_codes::seta, op_codes::setna, op_codes::setae, op_codes::setnae,
+                            op_codes::setb, op_codes::setnb, op_codes::setbe, op_codes::setnbe,
+                            op_codes::setc, op_codes::setnc, op_codes::setg, op_codes::setng,
+                            op_codes::setge, op_codes::setnge, op_codes::setl, op_codes::setnl,
+                            op_codes::setle, op_codes::setnle, op_codes::sets, op_codes::setns,
+                            op_codes::seto, op_codes::setno, op_codes::setz, op_codes::setnz}) {
+            handlers[static_cast<uint8_t>(set_op)] = &&op_set;
+        }
+
+        _fused_handlers[static_cast<size_t>(superinstruction_t::load_alu)] = &&op_load_alu;
+        _fused_handlers[static_cast<size_t>(superinstruction_t::alu_store)] = &&op_alu_store;
+        _fused_handlers[static_cast<size_t>(superinstruction_t::load_alu_store)] = &&op_load_alu_store;
+        _fused_handlers[static_cast<size_t>(superinstruction_t::compare_branch)] = &&op_compare_branch;
+
+        if (_ops.empty())
+            allocate_ops(&&op_translate);
+
+        auto regs = _terp->_registers.r;
+        auto heap_bottom = _terp->_heap_address;
+        auto heap_top = _terp->_heap_address + _terp->_heap_size;
+        auto program_size = _ops.size() * instruction_t::alignment;
+        threaded_op_t* op = nullptr;
+        uint64_t address = 0;
+
+        // pc lives in a local while dispatching; register_pc is only written
+        // back before anything that can observe it
+        auto pc = regs[register_pc].qw;
+
+#define SYNC_PC() regs[register_pc].qw = pc
+
+#define RELOAD_PC() pc = regs[register_pc].qw
+
+#define DISPATCH() \
+        do { \
+            auto offset = pc - _program_start; \
+            if (offset >= program_size \
+            ||  (offset % instruction_t::alignment) != 0) \
+                goto out_of_program; \
+            op = &_ops[offset / instruction_t::alignment]; \
+            goto *op->handler; \
+        } while (false)
+
+// block entries are counted, and compiled once hot, only with the jit enabled
+#define DISPATCH_TARGET() \
+        do { \
+            if (_jit) { \
+                auto offset = pc - _program_start; \
+                if (offset < program_size \
+                &&  (offset % instruction_t::alignment) == 0) { \
+                    op = &_ops[offset / instruction_t::alignment]; \
+                    if (op->native == nullptr \
+                    &&  op->hits < native_threshold \
+                    &&  ++op->hits == native_threshold) { \
+                        compile_native(pc, handlers, &&op_generic); \
+                    } \
+                    if (op->native != nullptr) \
+                        goto op_native; \
+                } \
+            } \
+            DISPATCH(); \
+        } while (false)
+
+#define SET_FLAGS(flags) \
+        do { \
+            _pending_flags.compute = nullptr; \
+            set_flags(regs, flags); \
+        } while (false)
+
+#define MATERIALIZE_FLAGS() \
+        do { \
+            if (_pending_flags.compute != nullptr) \
+                materialize_flags(); \
+        } while (false)
+
+#define CHECK_ADDRESS() \
+        do { \
+            if (address < heap_bottom || address > heap_top) { \
+                MATERIALIZE_FLAGS(); \
+                SYNC_PC(); \
+                operand_value_t checked_address; \
+                checked_address.alias.u = address; \
+                if (!_terp->bounds_check_address(r, checked_address)) \
+                    return false; \
+            } \
+        } while (false)
+
+#define LOAD(load_op) \
+        do { \
+            pc += (load_op)->inst_size; \
+            address = operand_value(regs, (load_op)->operands[1]); \
+            if ((load_op)->operands_count > 2) { \
+                auto offset = operand_value(regs, (load_op)->operands[2]); \
+                if ((load_op)->operands[2].is_negative) \
+                    address -= offset; \
+                else \
+                    address += offset; \
+            } \
+            CHECK_ADDRESS(); \
+            uint64_t value = 0; \
+            memcpy(&value, reinterpret_cast<void*>(address), op_size_in_bytes((load_op)->size)); \
+            set_zoned_value(regs[(load_op)->operands[0].reg_index], value, (load_op)->size); \
+            SET_FLAGS(zero_negative_flags((load_op)->size, value, value)); \
+        } while (false)
+
+#define STORE(store_op) \
+        do { \
+            pc += (store_op)->inst_size; \
+            address = operand_value(regs, (store_op)->operands[0]); \
+            if ((store_op)->operands_count > 2) { \
+                auto offset = operand_value(regs, (store_op)->operands[2]); \
+                if ((store_op)->operands[2].is_negative) \
+                    address -= offset; \
+                else \
+                    address += offset; \
+            } \
+            CHECK_ADDRESS(); \
+            auto value = operand_value(regs, (store_op)->operands[1]); \
+            memcpy(reinterpret_cast<void*>(address), &value, op_size_in_bytes((store_op)->size)); \
+            if (address - _program_start < program_size) \
+                _terp->invalidate_code(address, op_size_in_bytes((store_op)->size)); \
+            SET_FLAGS(zero_negative_flags((store_op)->size, value, value)); \
+        } while (false)
+
+#define ALU(alu_op) \
+        do { \
+            pc += (alu_op)->inst_size; \
+            (alu_op)->alu(this, regs, *(alu_op)); \
+        } while (false)
+
+#define SET(set_op) \
+        do { \
+            MATERIALIZE_FLAGS(); \
+            pc += (set_op)->inst_size; \
+            set_zoned_value( \
+                regs[(set_op)->operands[0].reg_index], \
+                condition_met((set_op)->inst.op, regs[register_fr].qw) ? 1 : 0, \
+                (set_op)->size); \
+        } while (false)
+
+#define OP_ADDRESS(current_op) \
+        (_program_start + static_cast<uint64_t>((current_op) - _ops.data()) * instruction_t::alignment)
+
+// records a taken control transfer from current_op to pc in the trace ring
+#define TRACE(current_op) _terp->_trace.record(OP_ADDRESS(current_op), pc)
+
+#define BRANCH_IF_ZERO(branch_op, branch_if_zero) \
+        do { \
+            pc += (branch_op)->inst_size; \
+            auto value = operand_value(regs, (branch_op)->operands[0]); \
+            auto flags = zero_negative_flags((branch_op)->size, value, value); \
+            if (((flags & register_file_t::flags_t::zero) != 0) == (branch_if_zero)) { \
+                pc = (branch_op)->has_target ? \
+                    (branch_op)->target : \
+                    operand_value(regs, (branch_op)->operands[1]); \
+                TRACE(branch_op); \
+            } \
+            SET_FLAGS(flags); \
+        } while (false)
+
+#define NEXT_OP(current_op) ((current_op) + (current_op)->inst_size / instruction_t::alignment)
+
+        DISPATCH();
+
+    op_translate:
+        if (!translate(r, pc, *op, handlers, &&op_generic)) {
+            SYNC_PC();
+            return false;
+        }
+        goto *op->handler;
+
+    op_generic: {
+        MATERIALIZE_FLAGS();
+        pc += op->inst_size;
+        SYNC_PC();
+        if (!_terp->execute(r, op->inst, op->inst_size))
+            return false;
+        if (_terp->_exited)
+            return true;
+        auto next = pc;
+        RELOAD_PC();
+        if (pc != next)
+            TRACE(op);
+        DISPATCH();
+    }
+
+    op_native: {
+        auto next = op->native(this, regs);
+        pc = next & ~native_deopt_bit;
+        if ((next & native_deopt_bit) != 0)
+            DISPATCH();
+        // transfers inside a native block aren't traced; its exit is
+        // recorded as a transfer from the block's entry
+        TRACE(op);
+        DISPATCH_TARGET();
+    }
+
+    out_of_program:
+        MATERIALIZE_FLAGS();
+        SYNC_PC();
+        // a fiber's entry procedure returned
+        if (pc == 0 && _terp->_current_fiber != 0) {
+            if (!_terp->finish_fiber(r))
+                return false;
+            RELOAD_PC();
+            DISPATCH();
+        }
+        if (!_terp->step(r))
+            return false;
+        if (_terp->_exited)
+            return true;
+        RELOAD_PC();
+        DISPATCH();
+
+    op_nop:
+        pc += op->inst_size;
+        DISPATCH();
+
+    op_load:
+        LOAD(op);
+        DISPATCH();
+
+    op_store:
+        STORE(op);
+        DISPATCH();
+
+    op_move: {
+        pc += op->inst_size;
+        auto source = operand_value(regs, op->operands[1]);
+        address = source;
+        if (op->operands_count > 2) {
+            auto offset = operand_value(regs, op->operands[2]);
+            if (op->operands[2].is_negative)
+                address -= offset;
+            else
+                address += offset;
+        }
+        set_zoned_value(regs[op->operands[0].reg_index], address, op->size);
+
+        uint64_t flags = 0;
+        if (source == 0)
+            flags |= register_file_t::flags_t::zero;
+        if (is_negative(op->size, source))
+            flags |= register_file_t::flags_t::negative;
+        SET_FLAGS(flags);
+        DISPATCH();
+    }
+
+    op_push: {
+        pc += op->inst_size;
+        auto value = operand_value(regs, op->operands[0]);
+        regs[register_sp].qw -= sizeof(uint64_t);
+        memcpy(reinterpret_cast<void*>(regs[register_sp].qw), &value, sizeof(uint64_t));
+
+        uint64_t flags = 0;
+        if (value == 0)
+            flags |= register_file_t::flags_t::zero;
+        if (is_negative(op->size, value))
+            flags |= register_file_t::flags_t::negative;
+        SET_FLAGS(flags);
+        DISPATCH();
+    }
+
+    op_pop: {
+        pc += op->inst_size;
+        uint64_t value = 0;
+        memcpy(&value, reinterpret_cast<void*>(regs[register_sp].qw), sizeof(uint64_t));
+        regs[register_sp].qw += sizeof(uint64_t);
+        set_zoned_value(regs[op->operands[0].reg_index], value, op->size);
+
+        uint64_t flags = 0;
+        if (value == 0)
+            flags |= register_file_t::flags_t::zero;
+        if (is_negative(op->size, value))
+            flags |= register_file_t::flags_t::negative;
+        SET_FLAGS(flags);
+        DISPATCH();
+    }
+
+    op_alu:
+        ALU(op);
+        DISPATCH();
+
+    op_bz:
+        BRANCH_IF_ZERO(op, true);
+        DISPATCH_TARGET();
+
+    op_bnz:
+        BRANCH_IF_ZERO(op, false);
+        DISPATCH_TARGET();
+
+    op_branch: {
+        MATERIALIZE_FLAGS();
+        pc += op->inst_size;
+        if (!condition_met(op->inst.op, regs[register_fr].qw))
+            DISPATCH();
+        if (op->has_target) {
+            pc = op->target;
+            TRACE(op);
+            DISPATCH_TARGET();
+        }
+        goto branch_to_computed_target;
+    }
+
+    op_set:
+        SET(op);
+        DISPATCH();
+
+    op_jsr: {
+        pc += op->inst_size;
+        auto return_address = pc;
+        regs[register_sp].qw -= sizeof(uint64_t);
+        memcpy(reinterpret_cast<void*>(regs[register_sp].qw), &return_address, sizeof(uint64_t));
+        if (op->has_target) {
+            pc = op->target;
+            TRACE(op);
+            DISPATCH_TARGET();
+        }
+        goto branch_to_computed_target;
+    }
+
+    op_jmp: {
+        pc += op->inst_size;
+        if (op->has_target) {
+            pc = op->target;
+            TRACE(op);
+            DISPATCH_TARGET();
+        }
+        goto branch_to_computed_target;
+    }
+
+    branch_to_computed_target: {
+        address = operand_value(regs, op->operands[0]);
+        if (op->operands_count >= 2) {
+            auto offset = operand_value(regs, op->operands[1]);
+            if (op->operands[1].is_negative)
+                address -= offset + op->inst_size;
+            else
+                address += offset - op->inst_size;
+        }
+        pc = address;
+        TRACE(op);
+        DISPATCH_TARGET();
+    }
+
+    op_rts: {
+        uint64_t return_address = 0;
+        memcpy(&return_address, reinterpret_cast<void*>(regs[register_sp].qw), sizeof(uint64_t));
+        regs[register_sp].qw += sizeof(uint64_t);
+        pc = return_address;
+        TRACE(op);
+        DISPATCH_TARGET();
+    }
+
+    op_exit:
+        pc += op->inst_size;
+        SYNC_PC();
+        _terp->_exited = true;
+        return true;
+
+    op_ffi:
+        pc += op->inst_size;
+        _terp->call_foreign(*op->ffi_plan);
+        DISPATCH();
+
+    op_load_alu: {
+        auto alu_op = NEXT_OP(op);
+        LOAD(op);
+        ALU(alu_op);
+        DISPATCH();
+    }
+
+    op_alu_store: {
+        auto store_op = NEXT_OP(op);
+        ALU(op);
+        STORE(store_op);
+        DISPATCH();
+    }
+
+    op_load_alu_store: {
+        auto alu_op = NEXT_OP(op);
+        auto store_op = NEXT_OP(alu_op);
+        LOAD(op);
+        ALU(alu_op);
+        STORE(store_op);
+        DISPATCH();
+    }
+
+    op_compare_branch: {
+        auto set_op = NEXT_OP(op);
+        auto branch_op = NEXT_OP(set_op);
+        ALU(op);
+        SET(set_op);
+        BRANCH_IF_ZERO(branch_op, branch_op->inst.op == op_codes::bz);
+        DISPATCH_TARGET();
+    }
+
+#undef TRACE
+#undef OP_ADDRESS
+#undef NEXT_OP
+#undef BRANCH_IF_ZERO
+#undef SET
+#undef ALU
+#undef STORE
+#undef LOAD
+#undef CHECK_ADDRESS
+#undef MATERIALIZE_FLAGS
+#undef SET_FLAGS
+#undef DISPATCH_TARGET
+#undef DISPATCH
+#undef RELOAD_PC
+#undef SYNC_PC
+    }
+
+};
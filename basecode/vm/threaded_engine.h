@@ -0,0 +1,276 @@
+// ----------------------------------------------------------------------------
+//
+// Basecode Bootstrap Compiler
+// Copyright (C) 2018 Jeff Panici
+// All rights reserved.
+//
+// This software source file is licensed under the terms of MIT license.
+// For details, please read the LICENSE file.
+//
+// ----------------------------------------------------------------------------
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <common/result.h>
+#include "jit.h"
+#include "vm_types.h"
+
+namespace basecode::vm {
+
+    struct threaded_op_t;
+    class threaded_engine;
+
+    using alu_handler_t = void (*)(
+        threaded_engine* engine,
+        register_value_alias_t* regs,
+        const threaded_op_t& op);
+
+    // returns the address to continue at; native_deopt_bit is set when the
+    // instruction at that address must be interpreted first
+    using native_block_t = uint64_t (*)(
+        threaded_engine* engine,
+        register_value_alias_t* regs);
+
+    using alu_flags_handler_t = uint64_t (*)(
+        uint64_t lhs,
+        uint64_t rhs,
+        uint64_t result);
+
+    // the last alu operation whose flags haven't been written to register_fr
+    struct pending_flags_t {
+        alu_flags_handler_t compute = nullptr;
+        uint64_t lhs = 0;
+        uint64_t rhs = 0;
+        uint64_t result = 0;
+    };
+
+    enum class superinstruction_t : uint8_t {
+        load_alu,
+        alu_store,
+        load_alu_store,
+        compare_branch,
+        count
+    };
+
+    struct threaded_operand_t {
+        uint64_t value = 0;
+        uint8_t reg_index = 0;
+        bool is_reg = false;
+        bool is_integer = true;
+        bool is_negative = false;
+    };
+
+    struct threaded_op_t {
+        const void* handler = nullptr;
+        alu_handler_t alu = nullptr;
+        uint8_t inst_size = 0;
+        uint16_t fused_size = 0;
+        op_sizes size = op_sizes::none;
+        uint8_t operands_count = 0;
+        bool has_target = false;
+        uint16_t hits = 0;
+        uint64_t target = 0;
+        native_block_t native = nullptr;
+        const ffi_call_plan_t* ffi_plan = nullptr;
+        threaded_operand_t operands[4];
+        instruction_t inst {};
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+
+    // the threaded engine translates each instruction in the program region
+    // exactly once into a threaded_op_t with resolved register indices and a
+    // handler address, then executes them with computed-goto dispatch.  op codes
+    // without a dedicated handler fall back to terp::execute.  dispatch keeps
+    // pc in a local and only writes it back to the register file before the
+    // fallback, address traps and on return; instructions that name pc as an
+    // operand always take the fallback.
+    //
+    // integer alu op codes are executed by alu_handler, which is instantiated
+    // for every op code, op_sizes and register/constant operand combination.
+    // translate picks the specialization once, so the handlers don't branch on
+    // size or operand kind.
+    //
+    // with lazy flags enabled, the alu handlers only record their operands and
+    // result in _pending_flags.  register_fr is materialized before anything
+    // that can read it: branches, set*, the generic handler (pushm, traps)
+    // and on return from run.
+    //
+    // with the jit enabled, every instruction reached by a branch, jump or
+    // return counts as a block entry.  once an entry has been reached
+    // native_threshold times, the straight-line region starting there is
+    // compiled into a native x86-64 block.  branches between instructions of
+    // the region stay native.  load, store, move, push, pop and the simple
+    // alu ops are emitted inline when no one reads the flags they write;
+    // everything else calls the native_* helpers or the op's alu handler.
+    // ffi, trap, swi, meta and any other instruction without a dedicated
+    // handler end the region and deopt back to dispatch, as do loads and
+    // stores outside of the heap.  a store that invalidates native code
+    // leaves the block right after the store.
+    //
+    // with superinstructions enabled, translate folds load + alu + store,
+    // load + alu, alu + store and cmp + set* + bz/bnz sequences into the op
+    // of their first instruction.  the fused handler runs every instruction
+    // of the sequence before the next dispatch.  the ops of the following
+    // instructions keep their own handlers, so a branch into the middle of a
+    // sequence still works.
+    class threaded_engine {
+    public:
+        static constexpr uint16_t native_threshold = 64;
+        static constexpr size_t maximum_native_region = 256;
+        static constexpr uint64_t native_deopt_bit = 1;
+
+        explicit threaded_engine(terp* terp);
+
+        void reset();
+
+        bool jit() const;
+
+        void jit(bool value);
+
+        bool lazy_flags() const;
+
+        void lazy_flags(bool value);
+
+        size_t fused_count() const;
+
+        size_t native_block_count() const;
+
+        size_t superinstruction_count() const;
+
+        bool superinstructions() const;
+
+        void superinstructions(bool value);
+
+        bool run(common::result& r);
+
+        void invalidate(uint64_t address, size_t size);
+
+    private:
+        template <op_codes Op, op_sizes Size, bool LhsIsReg, bool RhsIsReg, bool LazyFlags>
+        static void alu_handler(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op);
+
+        template <op_codes Op, bool LazyFlags>
+        static alu_handler_t alu_handler_for(
+            op_sizes size,
+            bool lhs_is_reg,
+            bool rhs_is_reg);
+
+        template <op_codes Op>
+        static alu_handler_t alu_handler_for(
+            op_sizes size,
+            bool lhs_is_reg,
+            bool rhs_is_reg,
+            bool lazy_flags);
+
+        alu_handler_t select_alu_handler(const threaded_op_t& op) const;
+
+        void materialize_flags();
+
+        void clear_ops();
+
+        bool in_heap(uint64_t address) const;
+
+        static bool native_load(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op);
+
+        static uint64_t native_store(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op);
+
+        static void native_move(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op);
+
+        static void native_push(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op);
+
+        static void native_pop(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op);
+
+        static void native_set(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op);
+
+        static bool native_branch_if_zero(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op);
+
+        static bool native_condition_met(
+            threaded_engine* engine,
+            register_value_alias_t* regs,
+            const threaded_op_t& op);
+
+        static void native_push_return(
+            register_value_alias_t* regs,
+            uint64_t return_address);
+
+        static uint64_t native_pop_return(register_value_alias_t* regs);
+
+        void compile_native(
+            uint64_t address,
+            const void* const* handlers,
+            const void* generic_handler);
+
+        bool dispatch(common::result& r);
+
+        bool translate(
+            common::result& r,
+            uint64_t address,
+            threaded_op_t& op,
+            const void* const* handlers,
+            const void* generic_handler);
+
+        void fuse(
+            common::result& r,
+            uint64_t address,
+            threaded_op_t& op,
+            const void* const* handlers,
+            const void* generic_handler);
+
+        size_t peek(
+            common::result& r,
+            uint64_t address,
+            op_codes& op_code);
+
+        void allocate_ops(const void* translate_handler);
+
+    private:
+        // a compiled region: its entry op and the program range it covers
+        struct native_region_t {
+            size_t entry = 0;
+            uint64_t start = 0;
+            uint64_t end = 0;
+        };
+
+        terp* _terp = nullptr;
+        bool _jit = false;
+        bool _lazy_flags = false;
+        size_t _fused_count = 0;
+        uint64_t _program_start = 0;
+        bool _superinstructions = false;
+        size_t _superinstruction_count = 0;
+        pending_flags_t _pending_flags {};
+        const void* _translate_handler = nullptr;
+        std::vector<threaded_op_t> _ops {};
+        native_code_buffer _native_code {};
+        std::vector<native_region_t> _native_regions {};
+        const void* _fused_handlers[static_cast<size_t>(superinstruction_t::count)] {};
+    };
+
+};
@@ -35,11 +35,15 @@ namespace basecode::vm {
     class symbol;
     class segment;
     class assembler;
+    class heap_snapshot;
+    class profiler;
     class assembly_parser;
     class assembly_listing;
     class instruction_block;
     class register_allocator;
 
+    struct ffi_call_plan_t;
+
     using symbol_list_t = std::vector<symbol*>;
     using symbol_address_map = std::unordered_map<std::string, void*>;
     using id_resolve_callable = std::function<std::string (uint64_t)>;
@@ -99,6 +103,7 @@ namespace basecode::vm {
         sr,
         integer,
         floating_point,
+        vector,
     };
 
     enum registers_t : uint8_t {
@@ -214,6 +219,14 @@ namespace basecode::vm {
             };
         }
 
+        static register_t vector(uint8_t number) {
+            return register_t {
+                .size = op_sizes::qword,
+                .number = static_cast<registers_t>(number),
+                .type = register_type_t::vector,
+            };
+        }
+
         static register_t empty() {
             return register_t {
                 .size = op_sizes::qword,
@@ -263,6 +276,34 @@ namespace basecode::vm {
         return 0;
     }
 
+    // the vector registers are a separate bank of 256-bit registers.  an
+    // instruction's size picks the lane width: byte, word, dword or qword
+    // lanes for the integer ops, dword (f32) or qword (f64) lanes for the
+    // float ops.  the lane types are compiler vector extensions, so the
+    // host compiler emits its own simd instructions for them.
+    static constexpr const uint32_t number_vector_registers = 16;
+    static constexpr const size_t vector_register_size = 32;
+
+    using vector_u8_t  = uint8_t  __attribute__((vector_size(vector_register_size)));
+    using vector_u16_t = uint16_t __attribute__((vector_size(vector_register_size)));
+    using vector_u32_t = uint32_t __attribute__((vector_size(vector_register_size)));
+    using vector_u64_t = uint64_t __attribute__((vector_size(vector_register_size)));
+    using vector_f32_t = float    __attribute__((vector_size(vector_register_size)));
+    using vector_f64_t = double   __attribute__((vector_size(vector_register_size)));
+
+    union vector_register_t {
+        vector_u8_t  b;
+        vector_u16_t w;
+        vector_u32_t dw;
+        vector_u64_t qw;
+        vector_f32_t dwf;
+        vector_f64_t qwf;
+    };
+
+    struct vector_register_file_t {
+        vector_register_t v[number_vector_registers];
+    };
+
     struct register_file_t {
         enum flags_t : uint64_t {
             zero     = 0b0000000000000000000000000000000000000000000000000000000000000001,
@@ -378,6 +419,20 @@ namespace basecode::vm {
         ffi,
         meta,
         exit,
+        fiber,
+        yield,
+        resume,
+        vload,
+        vstore,
+        vbroadcast,
+        vadd,
+        vsub,
+        vmul,
+        vfadd,
+        vfsub,
+        vfmul,
+        vreduce,
+        vfreduce,
     };
 
     inline static std::map<op_codes, std::string> s_op_code_names = {
@@ -471,6 +526,20 @@ namespace basecode::vm {
         {op_codes::ffi,    "FFI"},
         {op_codes::meta,   "META"},
         {op_codes::exit,   "EXIT"},
+        {op_codes::fiber,  "FIBER"},
+        {op_codes::yield,  "YIELD"},
+        {op_codes::resume, "RESUME"},
+        {op_codes::vload,  "VLOAD"},
+        {op_codes::vstore, "VSTORE"},
+        {op_codes::vbroadcast,"VBROADCAST"},
+        {op_codes::vadd,   "VADD"},
+        {op_codes::vsub,   "VSUB"},
+        {op_codes::vmul,   "VMUL"},
+        {op_codes::vfadd,  "VFADD"},
+        {op_codes::vfsub,  "VFSUB"},
+        {op_codes::vfmul,  "VFMUL"},
+        {op_codes::vreduce,"VREDUCE"},
+        {op_codes::vfreduce,"VFREDUCE"},
     };
 
     inline static std::string op_code_name(op_codes type) {
@@ -502,6 +571,23 @@ namespace basecode::vm {
         assembler_named_ref_type_t type = assembler_named_ref_type_t::none;
     };
 
+    enum class relocation_type_t : uint8_t {
+        heap_address,
+        foreign_function,
+    };
+
+    // an absolute address encoded into the program region.  instruction
+    // relocations name the operand holding the address, data relocations
+    // the size of the value written at address.
+    struct relocation_t {
+        relocation_type_t type = relocation_type_t::heap_address;
+        uint64_t address = 0;
+        uint8_t operand = 0;
+        op_sizes size = op_sizes::none;
+    };
+
+    using relocation_list_t = std::vector<relocation_t>;
+
     ///////////////////////////////////////////////////////////////////////////
 
     union operand_value_alias_t {
@@ -538,6 +624,7 @@ namespace basecode::vm {
             dword       = 0b00010000,
             word        = 0b00100000,
             byte        = 0b01000000,
+            vector      = 0b10000000,
         };
 
         void size_to_flags() {
@@ -579,6 +666,10 @@ namespace basecode::vm {
             return (type & flags::integer) == flags::integer;
         }
 
+        inline bool is_vector() const {
+            return (type & flags::vector) == flags::vector;
+        }
+
         inline bool is_negative() const {
             return (type & flags::negative) == flags::negative;
         }
@@ -596,6 +687,7 @@ namespace basecode::vm {
     struct instruction_t {
         static constexpr size_t base_size = 3;
         static constexpr size_t alignment = 4;
+        static constexpr size_t maximum_size = base_size + (4 * (1 + sizeof(uint64_t)));
 
         size_t decode(
             common::result& r,
@@ -1040,6 +1132,7 @@ namespace basecode::vm {
             sp_register      = 0b00010000,
             fp_register      = 0b00100000,
             range            = 0b01000000,
+            vector_register  = 0b10000000,
         };
 
         uint8_t types = flags::none;
@@ -1681,6 +1774,154 @@ namespace basecode::vm {
                 {}
             }
         },
+        {
+            "FIBER",
+            mnemonic_t{
+                op_codes::fiber,
+                {
+                    {mnemonic_operand_t::flags::integer_register, true},
+                    {mnemonic_operand_t::flags::integer_register | mnemonic_operand_t::flags::immediate, true},
+                    {mnemonic_operand_t::flags::integer_register | mnemonic_operand_t::flags::immediate, true},
+                }
+            }
+        },
+        {
+            "YIELD",
+            mnemonic_t{
+                op_codes::yield,
+                {
+                    {mnemonic_operand_t::flags::integer_register | mnemonic_operand_t::flags::immediate, true},
+                }
+            }
+        },
+        {
+            "RESUME",
+            mnemonic_t{
+                op_codes::resume,
+                {
+                    {mnemonic_operand_t::flags::integer_register, true},
+                    {mnemonic_operand_t::flags::integer_register, true},
+                }
+            }
+        },
+        {
+            "VLOAD",
+            mnemonic_t{
+                op_codes::vload,
+                {
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::integer_register, true},
+                    {mnemonic_operand_t::flags::immediate, false},
+                }
+            }
+        },
+        {
+            "VSTORE",
+            mnemonic_t{
+                op_codes::vstore,
+                {
+                    {mnemonic_operand_t::flags::integer_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::immediate, false},
+                }
+            }
+        },
+        {
+            "VBROADCAST",
+            mnemonic_t{
+                op_codes::vbroadcast,
+                {
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::integer_register | mnemonic_operand_t::flags::float_register | mnemonic_operand_t::flags::immediate, true},
+                }
+            }
+        },
+        {
+            "VADD",
+            mnemonic_t{
+                op_codes::vadd,
+                {
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                }
+            }
+        },
+        {
+            "VSUB",
+            mnemonic_t{
+                op_codes::vsub,
+                {
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                }
+            }
+        },
+        {
+            "VMUL",
+            mnemonic_t{
+                op_codes::vmul,
+                {
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                }
+            }
+        },
+        {
+            "VFADD",
+            mnemonic_t{
+                op_codes::vfadd,
+                {
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                }
+            }
+        },
+        {
+            "VFSUB",
+            mnemonic_t{
+                op_codes::vfsub,
+                {
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                }
+            }
+        },
+        {
+            "VFMUL",
+            mnemonic_t{
+                op_codes::vfmul,
+                {
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                }
+            }
+        },
+        {
+            "VREDUCE",
+            mnemonic_t{
+                op_codes::vreduce,
+                {
+                    {mnemonic_operand_t::flags::integer_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                }
+            }
+        },
+        {
+            "VFREDUCE",
+            mnemonic_t{
+                op_codes::vfreduce,
+                {
+                    {mnemonic_operand_t::flags::float_register, true},
+                    {mnemonic_operand_t::flags::vector_register, true},
+                }
+            }
+        },
     };
 
     inline static mnemonic_t* mnemonic(const std::string& code) {
@@ -1995,12 +2236,25 @@ namespace basecode::vm {
         free_space_start,
     };
 
+    enum class execution_engine_t : uint8_t {
+        stepped,
+        threaded,
+    };
+
+    using allocator_state_t = std::vector<uint64_t>;
+
     class allocator {
     public:
         virtual ~allocator();
 
         virtual void reset() = 0;
 
+        // the bookkeeping an allocator keeps outside of the vm heap.  a heap
+        // snapshot saves it along with the heap and restores both together.
+        virtual void save(allocator_state_t& state) const = 0;
+
+        virtual void restore(const allocator_state_t& state) = 0;
+
         virtual void initialize(
             uint64_t address,
             uint64_t size) = 0;
@@ -62,10 +62,19 @@ static void usage() {
         "[-v|--verbose] "
         "[--debugger] "
         "[--no-color] "
+        "[--vm-engine={{stepped|threaded}}] "
+        "[--vm-lazy-flags] "
+        "[--vm-superinstructions] "
+        "[--vm-big-endian] "
+        "[--vm-jit] "
+        "[--vm-allocator={{default|size-class|bump}}] "
+        "[--write-image={{filename}}] "
+        "[--vm-profile={{filename}}] "
+        "[--vm-trace={{filename}}] "
         "[-G] "
         "[-M{{path}} ...] "
         "[-H{{filename}}|--code_dom={{filename}}] "
-        "file [-- option ...]\n");
+        "{{file|--image={{filename}}}} [-- option ...]\n");
 }
 
 int main(int argc, char** argv) {
@@ -84,8 +93,19 @@ int main(int argc, char** argv) {
     bool debugger = false;
     bool help_flag = false;
     bool verbose_flag = false;
+    bool vm_lazy_flags = false;
+    bool vm_big_endian = false;
+    bool vm_superinstructions = false;
+    bool vm_jit = false;
+    bool size_class_flag = false;
+    bool bump_allocator_flag = false;
     bool output_ast_graphs = false;
+    auto vm_engine = vm::execution_engine_t::stepped;
     fs::path code_dom_graph_file_name;
+    fs::path load_image_file_name;
+    fs::path write_image_file_name;
+    fs::path vm_profile_file_name;
+    fs::path vm_trace_file_name;
     std::vector<fs::path> module_paths {};
     std::unordered_map<std::string, std::string> definitions {};
 
@@ -96,6 +116,16 @@ int main(int argc, char** argv) {
         {"code_dom",ya_required_argument, 0,       'H'},
         {"no-color",ya_no_argument,       0,       0  },
         {"debugger",ya_no_argument,       0,       0  },
+        {"vm-engine",ya_required_argument,0,       0  },
+        {"vm-lazy-flags",ya_no_argument,  0,       0  },
+        {"vm-allocator",ya_required_argument,0,    0  },
+        {"vm-superinstructions",ya_no_argument,0,  0  },
+        {"vm-big-endian",ya_no_argument,  0,       0  },
+        {"vm-jit",  ya_no_argument,       0,       0  },
+        {"write-image",ya_required_argument,0,     0  },
+        {"image",   ya_required_argument, 0,       0  },
+        {"vm-profile",ya_required_argument,0,      0  },
+        {"vm-trace",ya_required_argument, 0,       0  },
         {0,         0,                    0,       0  },
     };
 
@@ -132,6 +162,52 @@ int main(int argc, char** argv) {
                     case 5:
                         debugger = true;
                         break;
+                    case 6: {
+                        std::string engine_name(ya_optarg);
+                        if (engine_name == "threaded") {
+                            vm_engine = vm::execution_engine_t::threaded;
+                        } else if (engine_name == "stepped") {
+                            vm_engine = vm::execution_engine_t::stepped;
+                        } else {
+                            help_flag = true;
+                        }
+                        break;
+                    }
+                    case 7:
+                        vm_lazy_flags = true;
+                        break;
+                    case 8: {
+                        std::string allocator_name(ya_optarg);
+                        size_class_flag = allocator_name == "size-class";
+                        bump_allocator_flag = allocator_name == "bump";
+                        if (!size_class_flag
+                        &&  !bump_allocator_flag
+                        &&  allocator_name != "default") {
+                            help_flag = true;
+                        }
+                        break;
+                    }
+                    case 9:
+                        vm_superinstructions = true;
+                        break;
+                    case 10:
+                        vm_big_endian = true;
+                        break;
+                    case 11:
+                        vm_jit = true;
+                        break;
+                    case 12:
+                        write_image_file_name = ya_optarg;
+                        break;
+                    case 13:
+                        load_image_file_name = ya_optarg;
+                        break;
+                    case 14:
+                        vm_profile_file_name = ya_optarg;
+                        break;
+                    case 15:
+                        vm_trace_file_name = ya_optarg;
+                        break;
                     default:
                         abort();
                 }
@@ -178,7 +254,7 @@ int main(int argc, char** argv) {
 
     while (ya_optind < argc) {
         std::string arg(argv[ya_optind++]);
-        if (source_files.empty()) {
+        if (source_files.empty() && load_image_file_name.empty()) {
             source_files.emplace_back(arg);
         } else {
             if (separator_found) {
@@ -190,23 +266,43 @@ int main(int argc, char** argv) {
         }
     }
 
-    if (source_files.empty()) {
+    // a program image replaces the source files
+    if (source_files.empty() && load_image_file_name.empty()) {
         usage();
         return 1;
     }
 
-    vm::default_allocator allocator {};
+    // the jit is a tier of the threaded engine
+    if (vm_jit)
+        vm_engine = vm::execution_engine_t::threaded;
+
+    vm::default_allocator default_allocator {};
+    vm::size_class_allocator size_class_heap_allocator {};
+    vm::allocator* allocator = &default_allocator;
+    if (size_class_flag)
+        allocator = &size_class_heap_allocator;
+
     compiler::session_options_t session_options {
         .verbose = verbose_flag,
         .heap_size = heap_size,
         .debugger = debugger,
         .stack_size = stack_size,
         .output_ast_graphs = output_ast_graphs,
-        .allocator = &allocator,
+        .vm_lazy_flags = vm_lazy_flags,
+        .vm_big_endian = vm_big_endian,
+        .vm_superinstructions = vm_superinstructions,
+        .vm_jit = vm_jit,
+        .directive_bump_allocator = bump_allocator_flag,
+        .allocator = allocator,
+        .vm_engine = vm_engine,
         .compiler_path = fs::system_complete(argv[0]).remove_filename(),
         .meta_options = meta_options,
         .module_paths = module_paths,
         .dom_graph_file = code_dom_graph_file_name,
+        .load_image_file = load_image_file_name,
+        .write_image_file = write_image_file_name,
+        .vm_profile_file = vm_profile_file_name,
+        .vm_trace_file = vm_trace_file_name,
         .definitions = definitions,
         .compile_callback = [](
                 compiler::session_compile_phase_t phase,
@@ -0,0 +1,3 @@
+#!/usr/bin/env bash
+../bin/bc --vm-profile=$1.vmprof $@
+flamegraph.pl $1.vmprof.folded > $1.svg